@@ -41,6 +41,36 @@ int main(int argc, char *argv[]) {
 	return SUCCESS;
 }
 
+/**
+ * FUNCTION NAME: updateRing
+ *
+ * DESCRIPTION: Membership subscriber applying a node's events to its hash ring
+ */
+static void updateRing(void *env, long version, const vector<MembershipEvent> &events) {
+	HashRing *ring = (HashRing *) env;
+	vector<RingMove> moved;
+	Address addr;
+
+	for ( int i = 0; i < (int) events.size(); i++ ) {
+		addr = events[i].addr;
+		if ( events[i].type == EVENT_JOIN ) {
+			ring->add(&addr, &moved);
+		}
+		else if ( events[i].type == EVENT_FAIL || events[i].type == EVENT_LEAVE ) {
+			ring->remove(&addr, &moved);
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: trackRemovals
+ *
+ * DESCRIPTION: Membership subscriber passing a node's events on to the application
+ */
+static void trackRemovals(void *env, long version, const vector<MembershipEvent> &events) {
+	((Application *) env)->noteRemovals(events);
+}
+
 /**
  * Constructor of the Application class
  */
@@ -52,6 +82,26 @@ Application::Application(char *infile) {
 	log = new Log(par);
 	en = new EmulNet(par);
 	mp1 = (MP1Node **) malloc(par->EN_GPSZ * sizeof(MP1Node *));
+	rings = NULL;
+	departTime.assign(par->EN_GPSZ, -1);
+	departGraceful.assign(par->EN_GPSZ, false);
+	falseRemovals = 0;
+	if ( par->RING_VNODES > 0 ) {
+		rings = (HashRing **) malloc(par->EN_GPSZ * sizeof(HashRing *));
+	}
+	prof = NULL;
+	if ( par->PROFILE ) {
+		prof = new TickProfiler(par);
+		log->setProfiler(prof);
+	}
+	tracer = NULL;
+	if ( par->TRACE_SAMPLE > 0 ) {
+		tracer = new Tracer(par);
+	}
+	metrics = NULL;
+	if ( par->METRICS_PERIOD > 0 ) {
+		metrics = new MetricsExporter(par);
+	}
 
 	/*
 	 * Init all nodes
@@ -64,7 +114,15 @@ Application::Application(char *infile) {
 		joinaddr = getjoinaddr();
 		addressOfMemberNode = (Address *) en->ENinit(addressOfMemberNode, par->PORTNUM);
 		mp1[i] = new MP1Node(memberNode, par, en, log, addressOfMemberNode);
+		mp1[i]->setProfiler(prof);
+		mp1[i]->setTracer(tracer);
 		log->LOG(&(mp1[i]->getMemberNode()->addr), "APP");
+		mp1[i]->subscribe(trackRemovals, this);
+		if ( rings != NULL ) {
+			rings[i] = new HashRing(par->RING_VNODES);
+			rings[i]->add(&(mp1[i]->getMemberNode()->addr), NULL);
+			mp1[i]->subscribe(updateRing, rings[i]);
+		}
 		delete addressOfMemberNode;
 	}
 }
@@ -79,6 +137,15 @@ Application::~Application() {
 		delete mp1[i];
 	}
 	free(mp1);
+	if ( rings != NULL ) {
+		for ( int i = 0; i < par->EN_GPSZ; i++ ) {
+			delete rings[i];
+		}
+		free(rings);
+	}
+	delete prof;
+	delete tracer;
+	delete metrics;
 	delete par;
 }
 
@@ -101,15 +168,38 @@ int Application::run()
 		mp1Run();
 		// Fail some nodes
 		fail();
+		if ( par->TRAFFIC_MATRIX_PERIOD > 0 && (par->globaltime + 1) % par->TRAFFIC_MATRIX_PERIOD == 0 ) {
+			en->ENdumpMatrix();
+		}
+		if ( metrics != NULL ) {
+			if ( (par->globaltime + 1) % par->METRICS_PERIOD == 0 ) {
+				exportMetrics();
+			}
+			metrics->serve();
+		}
 	}
 
-	// Clean up
-	en->ENcleanup();
+	reportJoinStats();
+	reportRingStats();
+	reportDepartures();
+	reportOverlay();
+	reportProtocolCost();
+	reportTraffic();
+	reportProfile();
+	if ( metrics != NULL ) {
+		exportMetrics();
+	}
 
-	for(i=0;i<=par->EN_GPSZ-1;i++) {
-		 mp1[i]->finishUpThisNode();
+	// Only graceful runs leave the group at the end; a LEAVE sent otherwise is never delivered
+	if ( par->GRACEFUL_LEAVE ) {
+		for(i=0;i<=par->EN_GPSZ-1;i++) {
+			 mp1[i]->finishUpThisNode();
+		}
 	}
 
+	// Clean up
+	en->ENcleanup();
+
 	return SUCCESS;
 }
 
@@ -129,7 +219,13 @@ void Application::mp1Run() {
 		 */
 		if( par->getcurrtime() > (int)(par->STEP_RATE*i) && !(mp1[i]->getMemberNode()->bFailed) ) {
 			// Receive messages from the network and queue them
+			if ( prof ) {
+				prof->enter(PROF_RECV, i + 1);
+			}
 			mp1[i]->recvLoop();
+			if ( prof ) {
+				prof->leave();
+			}
 		}
 
 	}
@@ -152,7 +248,13 @@ void Application::mp1Run() {
 		 */
 		else if( par->getcurrtime() > (int)(par->STEP_RATE*i) && !(mp1[i]->getMemberNode()->bFailed) ) {
 			// handle messages and send heartbeats
+			if ( prof ) {
+				prof->enter(PROF_NODELOOP, i + 1);
+			}
 			mp1[i]->nodeLoop();
+			if ( prof ) {
+				prof->leave();
+			}
 			#ifdef DEBUGLOG
 			if( (i == 0) && (par->globaltime % 500 == 0) ) {
 				log->LOG(&mp1[i]->getMemberNode()->addr, "@@time=%d", par->getcurrtime());
@@ -183,7 +285,7 @@ void Application::fail() {
 		#ifdef DEBUGLOG
 		log->LOG(&mp1[removed]->getMemberNode()->addr, "Node failed at time=%d", par->getcurrtime());
 		#endif
-		mp1[removed]->getMemberNode()->bFailed = true;
+		depart(removed);
 	}
 	else if( par->getcurrtime() == 100 ) {
 		removed = rand() % par->EN_GPSZ/2;
@@ -191,7 +293,7 @@ void Application::fail() {
 			#ifdef DEBUGLOG
 			log->LOG(&mp1[i]->getMemberNode()->addr, "Node failed at time = %d", par->getcurrtime());
 			#endif
-			mp1[i]->getMemberNode()->bFailed = true;
+			depart(i);
 		}
 	}
 
@@ -201,6 +303,266 @@ void Application::fail() {
 
 }
 
+/**
+ * FUNCTION NAME: depart
+ *
+ * DESCRIPTION: Take node i down: with GRACEFUL_LEAVE it leaves the group first, otherwise
+ * 				it crashes
+ */
+void Application::depart(int i) {
+	if ( par->GRACEFUL_LEAVE ) {
+		mp1[i]->finishUpThisNode();
+		departGraceful[i] = true;
+	}
+	mp1[i]->getMemberNode()->bFailed = true;
+	departTime[i] = par->getcurrtime();
+}
+
+/**
+ * FUNCTION NAME: noteRemovals
+ *
+ * DESCRIPTION: Record how long after its departure a node was dropped by one of its peers
+ */
+void Application::noteRemovals(const vector<MembershipEvent> &events) {
+	for ( int k = 0; k < (int) events.size(); k++ ) {
+		// Node i has id i + 1
+		int i = *(int *)(events[k].addr.addr) - 1;
+		if ( (events[k].type != EVENT_FAIL && events[k].type != EVENT_LEAVE) ||
+			 i < 0 || i >= par->EN_GPSZ ) {
+			continue;
+		}
+		if ( departTime[i] < 0 ) {
+			// A live peer dropped from a partial view is not a mistake
+			falseRemovals += (events[k].type == EVENT_FAIL);
+			continue;
+		}
+		if ( departGraceful[i] ) {
+			leaveDelays.push_back(events[k].time - departTime[i]);
+		}
+		else {
+			crashDelays.push_back(events[k].time - departTime[i]);
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: reportDepartures
+ *
+ * DESCRIPTION: Log the delay from a node leaving or crashing to its removal by the others
+ */
+void Application::reportDepartures() {
+	vector<long> *delays[2] = { &leaveDelays, &crashDelays };
+	const char *kind[2] = { "leave", "crash" };
+
+	for ( int d = 0; d < 2; d++ ) {
+		vector<long> &v = *delays[d];
+		if ( v.empty() ) {
+			continue;
+		}
+		sort(v.begin(), v.end());
+		log->LOG(&mp1[0]->getMemberNode()->addr, "#STATSLOG# %s to removal over %d removals: p50 %ld p90 %ld max %ld ticks",
+				 kind[d], (int) v.size(), v[(v.size() - 1) / 2], v[(v.size() - 1) * 9 / 10], v.back());
+	}
+}
+
+/**
+ * FUNCTION NAME: reportOverlay
+ *
+ * DESCRIPTION: Partial-view mode: log whether the active views of the live nodes have
+ * 				converged to one connected overlay.  Links are taken as undirected; links to
+ * 				departed nodes are counted separately, as they should all have been dropped.
+ */
+void Application::reportOverlay() {
+	vector<int> root(par->EN_GPSZ);
+	vector<int> degree(par->EN_GPSZ, 0);
+	int live = 0;
+	int components = 0;
+	int dangling = 0;
+	int mindeg = -1;
+	int maxdeg = 0;
+	int i, j, k, a, b;
+
+	if ( par->VIEW_MODE != PARTIAL_VIEW ) {
+		return;
+	}
+	for ( i = 0; i < par->EN_GPSZ; i++ ) {
+		root[i] = i;
+	}
+	for ( i = 0; i < par->EN_GPSZ; i++ ) {
+		if ( departTime[i] >= 0 ) {
+			continue;
+		}
+		vector<MemberListEntry> &ml = mp1[i]->getMemberNode()->memberList;
+		for ( k = 0; k < (int) ml.size(); k++ ) {
+			// Node j has id j + 1
+			j = ml[k].getid() - 1;
+			if ( j == i || j < 0 || j >= par->EN_GPSZ ) {
+				continue;
+			}
+			if ( departTime[j] >= 0 ) {
+				dangling++;
+				continue;
+			}
+			degree[i]++;
+			for ( a = i; root[a] != a; a = root[a] );
+			for ( b = j; root[b] != b; b = root[b] );
+			root[a] = b;
+		}
+	}
+	for ( i = 0; i < par->EN_GPSZ; i++ ) {
+		if ( departTime[i] >= 0 ) {
+			continue;
+		}
+		live++;
+		components += (root[i] == i);
+		mindeg = (mindeg < 0) ? degree[i] : min(mindeg, degree[i]);
+		maxdeg = max(maxdeg, degree[i]);
+	}
+	log->LOG(&mp1[0]->getMemberNode()->addr, "#STATSLOG# overlay of %d live nodes: %d connected components, active view degree min %d max %d, %d links to departed nodes",
+			 live, components, mindeg, maxdeg, dangling);
+}
+
+/**
+ * FUNCTION NAME: reportProtocolCost
+ *
+ * DESCRIPTION: Log what the failure detection strategy cost per node and tick, so that
+ * 				protocols can be compared on the same scenario
+ */
+void Application::reportProtocolCost() {
+	long bytes = 0;
+	long packets = 0;
+	long ticks = 0;
+
+	for ( int i = 0; i < par->EN_GPSZ; i++ ) {
+		bytes += mp1[i]->getBytesSent();
+		packets += mp1[i]->getPacketsSent();
+		ticks += mp1[i]->getActiveTicks();
+	}
+	if ( ticks == 0 ) {
+		return;
+	}
+	log->LOG(&mp1[0]->getMemberNode()->addr, "#STATSLOG# protocol %s on %d nodes: %.1f bytes and %.2f packets per node per tick, %d false removals",
+			 mp1[0]->getProtocolName(), par->EN_GPSZ, (double) bytes / ticks, (double) packets / ticks, falseRemovals);
+}
+
+/**
+ * FUNCTION NAME: reportTraffic
+ *
+ * DESCRIPTION: Log, per message type, what was sent, delivered and dropped over all nodes
+ */
+void Application::reportTraffic() {
+	TrafficCount sent, delivered, prob, size, full;
+
+	for ( int type = 0; type < NUM_TRAFFIC_TYPES; type++ ) {
+		sent = en->ENtrafficTotal(type, TRAFFIC_SENT);
+		if ( sent.msgs == 0 ) {
+			continue;
+		}
+		delivered = en->ENtrafficTotal(type, TRAFFIC_DELIVERED);
+		prob = en->ENtrafficTotal(type, TRAFFIC_DROP_PROB);
+		size = en->ENtrafficTotal(type, TRAFFIC_DROP_SIZE);
+		full = en->ENtrafficTotal(type, TRAFFIC_DROP_FULL);
+		log->LOG(&mp1[0]->getMemberNode()->addr, "#STATSLOG# traffic %s: sent %ld msgs %ld B, delivered %ld msgs %ld B, dropped %ld/%ld/%ld msgs %ld/%ld/%ld B (probability/size/buffer full)",
+				 type == TRAFFIC_FRAMING ? "FRAMING" : msgTypeName(type), sent.msgs, sent.bytes, delivered.msgs, delivered.bytes,
+				 prob.msgs, size.msgs, full.msgs, prob.bytes, size.bytes, full.bytes);
+	}
+}
+
+/**
+ * FUNCTION NAME: reportJoinStats
+ *
+ * DESCRIPTION: Log the join load seen by the seeds and whoever they relayed requests to,
+ * 				and the percentiles of the join latency (first JOINREQ to first JOINREP) over
+ * 				all nodes that asked to join, and how many live nodes never got into the
+ * 				group or never got a complete view.  In partial-view mode no node is meant
+ * 				to know every other, so completeness of the join pairs does not apply
+ * 				there; reportOverlay checks the views instead.
+ */
+void Application::reportJoinStats() {
+	vector<long> latency;
+	int pending = 0;
+	int incomplete = 0;
+	int retries = 0;
+	int i;
+
+	for ( i = 0; i < par->EN_GPSZ; i++ ) {
+		mp1[i]->reportJoinLoad();
+		if ( mp1[i]->getJoinStartTime() < 0 ) {
+			continue;
+		}
+		retries += mp1[i]->getJoinAttempts() - 1;
+		// A node that crashed or left before its JOINREP came back is not counted
+		if ( mp1[i]->getJoinTime() < 0 ) {
+			pending += (departTime[i] < 0);
+		}
+		else {
+			latency.push_back(mp1[i]->getJoinTime() - mp1[i]->getJoinStartTime());
+			incomplete += (departTime[i] < 0 && !mp1[i]->joinComplete());
+		}
+	}
+
+	if ( latency.empty() ) {
+		return;
+	}
+	sort(latency.begin(), latency.end());
+	#define PCT(p) latency[(latency.size() - 1) * (p) / 100]
+	log->LOG(&mp1[0]->getMemberNode()->addr, "#STATSLOG# join latency over %d nodes: p50 %ld p90 %ld p99 %ld max %ld ticks; %d never joined, %d without a complete view, %d JOINREQ retransmissions",
+			 (int) latency.size(), PCT(50), PCT(90), PCT(99), latency.back(), pending, incomplete, retries);
+	#undef PCT
+}
+
+/**
+ * FUNCTION NAME: reportRingStats
+ *
+ * DESCRIPTION: Log how much of the key space moved per ring change on the live nodes, and
+ * 				on how many sampled keys all live nodes agree about the owner
+ */
+void Application::reportRingStats() {
+	const int samples = 1000;
+	long changes = 0;
+	double moved = 0;
+	int live = 0;
+	int agreed = 0;
+	Address first, other;
+	char key[32];
+	int i, k;
+
+	if ( rings == NULL ) {
+		return;
+	}
+
+	for ( i = 0; i < par->EN_GPSZ; i++ ) {
+		if ( mp1[i]->getMemberNode()->bFailed ) {
+			continue;
+		}
+		live++;
+		changes += rings[i]->getChanges();
+		moved += rings[i]->getMovedKeys();
+	}
+
+	for ( k = 0; k < samples; k++ ) {
+		uint32_t h;
+		bool agree = true;
+		bool seen = false;
+		sprintf(key, "key%d", k);
+		h = HashRing::keyHash(key);
+		for ( i = 0; i < par->EN_GPSZ && agree; i++ ) {
+			if ( mp1[i]->getMemberNode()->bFailed || !rings[i]->owner(h, &other) ) {
+				continue;
+			}
+			if ( !seen ) {
+				first = other;
+				seen = true;
+			}
+			agree = (first == other);
+		}
+		agreed += agree;
+	}
+
+	log->LOG(&mp1[0]->getMemberNode()->addr, "#STATSLOG# hash ring (%d vnodes) on %d live nodes: %ld changes, %.4f of the key space moved per change; owners agree on %d/%d keys",
+			 par->RING_VNODES, live, changes, changes ? moved / changes : 0.0, agreed, samples);
+}
+
 /**
  * FUNCTION NAME: getjoinaddr
  *
@@ -215,3 +577,138 @@ Address Application::getjoinaddr(void){
     //trace.funcExit("Application::getjoinaddr", SUCCESS);
     return joinaddr;
 }
+
+/**
+ * FUNCTION NAME: reportProfile
+ *
+ * DESCRIPTION: Summarise where the time of the ticks went and which node cost the most,
+ *              and write the full profile (PROFILE_LOG, PROFILE_FOLDED)
+ */
+void Application::reportProfile() {
+	unsigned long total = 0;
+	unsigned long worst = 0;
+	int worstNode = 0;
+	int worstPhase = 0;
+	int i, p;
+
+	if ( prof == NULL ) {
+		return;
+	}
+
+	for ( p = 0; p < PROF_MSG; p++ ) {
+		const PhaseCost &cost = prof->getCost(p);
+		if ( cost.calls == 0 ) {
+			continue;
+		}
+		log->LOG(&mp1[0]->getMemberNode()->addr, "#STATSLOG# profile %s: %ld calls, %.3f ms, %lu cycles, p50 < %lu ns, p99 < %lu ns",
+				 TickProfiler::phaseName(p), cost.calls, cost.ns / 1e6, cost.cycles, prof->percentile(p, 0.5), prof->percentile(p, 0.99));
+	}
+
+	for ( i = 1; i <= par->EN_GPSZ; i++ ) {
+		unsigned long ns = prof->getNodeTotal(i);
+		total += ns;
+		if ( ns > worst ) {
+			worst = ns;
+			worstNode = i;
+		}
+	}
+	if ( worstNode > 0 ) {
+		// nodeLoop holds most of the other phases, name the one inside it
+		for ( p = 0; p < NUM_PROFILE_PHASES; p++ ) {
+			if ( p != PROF_NODELOOP && prof->getNodeNs(worstNode, p) > prof->getNodeNs(worstNode, worstPhase) ) {
+				worstPhase = p;
+			}
+		}
+		log->LOG(&mp1[worstNode - 1]->getMemberNode()->addr, "#STATSLOG# profile: costliest node %d, %.3f of %.3f ms over all nodes, mostly in %s (%.3f ms)",
+				 worstNode, worst / 1e6, total / 1e6, TickProfiler::phaseName(worstPhase), prof->getNodeNs(worstNode, worstPhase) / 1e6);
+	}
+
+	prof->dump();
+}
+
+/**
+ * FUNCTION NAME: exportMetrics
+ *
+ * DESCRIPTION: Publish a Prometheus snapshot of the group, the network and the process
+ */
+void Application::exportMetrics() {
+	static const char *outcomes[NUM_TRAFFIC_OUTCOMES] = { "sent", "delivered", "dropped_probability", "dropped_size", "dropped_buffer_full" };
+	// Upper bounds of the removal delay buckets, in ticks
+	static const double delayBounds[] = { 5, 10, 15, 20, 30, 40, 50, 75, 100, 150, 200, 300 };
+	char labels[128];
+	long started = 0, acked = 0, indirect = 0, timedOut = 0;
+	int i, type, o;
+
+	metrics->begin();
+
+	metrics->family("mp1_tick", "gauge", "Current simulation tick.");
+	metrics->sample("mp1_tick", NULL, par->getcurrtime());
+
+	metrics->family("mp1_node_up", "gauge", "Whether the node is running and in the group.");
+	for ( i = 0; i < par->EN_GPSZ; i++ ) {
+		sprintf(labels, "node=\"%d\"", i + 1);
+		metrics->sample("mp1_node_up", labels, !mp1[i]->getMemberNode()->bFailed && mp1[i]->getMemberNode()->inGroup);
+	}
+	metrics->family("mp1_members", "gauge", "Entries in the membership list of the node.");
+	for ( i = 0; i < par->EN_GPSZ; i++ ) {
+		sprintf(labels, "node=\"%d\"", i + 1);
+		metrics->sample("mp1_members", labels, mp1[i]->getMemberNode()->memberList.size());
+	}
+	metrics->family("mp1_received_last_tick", "gauge", "Messages the node handled in its last tick (its queue depth).");
+	for ( i = 0; i < par->EN_GPSZ; i++ ) {
+		sprintf(labels, "node=\"%d\"", i + 1);
+		metrics->sample("mp1_received_last_tick", labels, mp1[i]->getRecvLastTick());
+	}
+	metrics->family("mp1_received_peak", "gauge", "Most messages the node handled in one tick.");
+	for ( i = 0; i < par->EN_GPSZ; i++ ) {
+		sprintf(labels, "node=\"%d\"", i + 1);
+		metrics->sample("mp1_received_peak", labels, mp1[i]->getPeakRecv());
+	}
+	metrics->family("mp1_network_queue_messages", "gauge", "Messages in flight in the emulated network.");
+	metrics->sample("mp1_network_queue_messages", NULL, en->ENbuffered());
+
+	metrics->family("mp1_messages_total", "counter", "Messages put on the network, by type and outcome.");
+	for ( type = 0; type < NUM_TRAFFIC_TYPES; type++ ) {
+		for ( o = 0; o < NUM_TRAFFIC_OUTCOMES; o++ ) {
+			if ( en->ENtrafficTotal(type, TRAFFIC_SENT).msgs == 0 ) {
+				continue;
+			}
+			sprintf(labels, "type=\"%s\",outcome=\"%s\"", type == TRAFFIC_FRAMING ? "FRAMING" : msgTypeName(type), outcomes[o]);
+			metrics->sample("mp1_messages_total", labels, en->ENtrafficTotal(type, o).msgs);
+		}
+	}
+	metrics->family("mp1_message_bytes_total", "counter", "Bytes put on the network, by type and outcome.");
+	for ( type = 0; type < NUM_TRAFFIC_TYPES; type++ ) {
+		for ( o = 0; o < NUM_TRAFFIC_OUTCOMES; o++ ) {
+			if ( en->ENtrafficTotal(type, TRAFFIC_SENT).msgs == 0 ) {
+				continue;
+			}
+			sprintf(labels, "type=\"%s\",outcome=\"%s\"", type == TRAFFIC_FRAMING ? "FRAMING" : msgTypeName(type), outcomes[o]);
+			metrics->sample("mp1_message_bytes_total", labels, en->ENtrafficTotal(type, o).bytes);
+		}
+	}
+
+	for ( i = 0; i < par->EN_GPSZ; i++ ) {
+		started += mp1[i]->getProbesStarted();
+		acked += mp1[i]->getProbesAcked();
+		indirect += mp1[i]->getProbesIndirect();
+		timedOut += mp1[i]->getProbesTimedOut();
+	}
+	metrics->family("mp1_probes_started_total", "counter", "Probes started by all nodes.");
+	metrics->sample("mp1_probes_started_total", NULL, started);
+	metrics->family("mp1_probes_total", "counter", "Probes ended, by outcome.");
+	metrics->sample("mp1_probes_total", "outcome=\"ack\"", acked);
+	metrics->sample("mp1_probes_total", "outcome=\"indirect_ack\"", indirect);
+	metrics->sample("mp1_probes_total", "outcome=\"timeout\"", timedOut);
+	metrics->family("mp1_probe_success_ratio", "gauge", "Share of ended probes that were acknowledged.");
+	metrics->sample("mp1_probe_success_ratio", NULL, acked + indirect + timedOut > 0 ? (double) (acked + indirect) / (acked + indirect + timedOut) : 1.0);
+
+	metrics->family("mp1_removal_delay_ticks", "histogram", "Ticks from a node leaving or crashing until another node removed it.");
+	metrics->histogram("mp1_removal_delay_ticks", "kind=\"crash\"", crashDelays, delayBounds, sizeof(delayBounds) / sizeof(delayBounds[0]));
+	metrics->histogram("mp1_removal_delay_ticks", "kind=\"leave\"", leaveDelays, delayBounds, sizeof(delayBounds) / sizeof(delayBounds[0]));
+	metrics->family("mp1_false_removals_total", "counter", "Removals of nodes that were still up.");
+	metrics->sample("mp1_false_removals_total", NULL, falseRemovals);
+
+	metrics->allocatorStats();
+	metrics->publish();
+}
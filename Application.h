@@ -14,6 +14,10 @@
 #include "Member.h"
 #include "EmulNet.h"
 #include "Queue.h"
+#include "HashRing.h"
+#include "TickProfiler.h"
+#include "Tracer.h"
+#include "Metrics.h"
 
 /**
  * global variables
@@ -40,6 +44,22 @@ private:
     Log *log;
 	MP1Node **mp1;
 	Params *par;
+	// Per-node consistent-hash rings fed by membership events (NULL unless RING_VNODES is set)
+	HashRing **rings;
+	// Tick each node left or crashed (-1 while it is up), whether it left on purpose,
+	// and the delays until other nodes removed it
+	vector<long> departTime;
+	vector<bool> departGraceful;
+	vector<long> leaveDelays;
+	vector<long> crashDelays;
+	// Removals of nodes that were still up
+	int falseRemovals;
+	// Phase timer (NULL unless PROFILE is set)
+	TickProfiler *prof;
+	// Probe tracer (NULL unless TRACE_SAMPLE is set)
+	Tracer *tracer;
+	// Prometheus snapshots (NULL unless METRICS_PERIOD is set)
+	MetricsExporter *metrics;
 public:
 	Application(char *);
 	virtual ~Application();
@@ -47,6 +67,16 @@ public:
 	int run();
 	void mp1Run();
 	void fail();
+	void reportJoinStats();
+	void reportRingStats();
+	void noteRemovals(const vector<MembershipEvent> &events);
+	void depart(int i);
+	void reportDepartures();
+	void reportOverlay();
+	void reportProtocolCost();
+	void reportTraffic();
+	void reportProfile();
+	void exportMetrics();
 };
 
 #endif /* _APPLICATION_H__ */
@@ -0,0 +1,729 @@
+/**********************************
+ * FILE NAME: Codec.cpp
+ *
+ * DESCRIPTION: Wire format of the membership protocol messages.
+ * 				Definition of MsgBuilder and MsgView classes.
+ **********************************/
+
+#include "Codec.h"
+
+/*
+ * Tables generated from the message schema
+ */
+#define SCHEMA_FIELD(name) FIELD_##name,
+#define SCHEMA_TABLE(type) static const int type##_fields[] = { type##_SCHEMA(SCHEMA_FIELD) -1 };
+MSG_TYPES(SCHEMA_TABLE)
+#undef SCHEMA_TABLE
+#undef SCHEMA_FIELD
+
+#define SCHEMA_ENTRY(type) type##_fields,
+static const int *schemas[DUMMYLASTMSGTYPE] = { MSG_TYPES(SCHEMA_ENTRY) };
+#undef SCHEMA_ENTRY
+
+#define FIELD_KIND(name, kind) kind,
+static const FieldKind fieldKinds[NUM_MSG_FIELDS] = { MSG_FIELDS(FIELD_KIND) };
+#undef FIELD_KIND
+
+#define TYPE_NAME(type) #type,
+static const char *typeNames[DUMMYLASTMSGTYPE] = { MSG_TYPES(TYPE_NAME) };
+#undef TYPE_NAME
+
+/**
+ * FUNCTION NAME: msgTypeName
+ *
+ * DESCRIPTION: Printable name of a message type
+ */
+const char *msgTypeName(int type) {
+	if ( type < 0 || type >= DUMMYLASTMSGTYPE ) {
+		return "UNKNOWN";
+	}
+	return typeNames[type];
+}
+
+/*
+ * Little-endian and varint primitives
+ */
+static void putLE(unsigned char *p, uint64_t v, int width) {
+	for ( int i = 0; i < width; i++ ) {
+		p[i] = (unsigned char)(v >> (8 * i));
+	}
+}
+
+static uint64_t getLE(const unsigned char *p, int width) {
+	uint64_t v = 0;
+	for ( int i = 0; i < width; i++ ) {
+		v |= (uint64_t)p[i] << (8 * i);
+	}
+	return v;
+}
+
+static uint64_t zigzag(int64_t v) {
+	return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static int64_t unzigzag(uint64_t v) {
+	return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static int varintSize(uint64_t v) {
+	int n = 1;
+	while ( v >= 0x80 ) {
+		v >>= 7;
+		n++;
+	}
+	return n;
+}
+
+static unsigned char *putVarint(unsigned char *p, uint64_t v) {
+	while ( v >= 0x80 ) {
+		*p++ = (unsigned char)(v | 0x80);
+		v >>= 7;
+	}
+	*p++ = (unsigned char)v;
+	return p;
+}
+
+static bool getVarint(const unsigned char **p, const unsigned char *end, uint64_t *v) {
+	uint64_t result = 0;
+	int shift = 0;
+	while ( *p < end && shift < 64 ) {
+		unsigned char b = *(*p)++;
+		result |= (uint64_t)(b & 0x7f) << shift;
+		if ( !(b & 0x80) ) {
+			*v = result;
+			return true;
+		}
+		shift += 7;
+	}
+	return false;
+}
+
+static void writeAddr(unsigned char *p, const Address *addr) {
+	int id;
+	short port;
+	memcpy(&id, &addr->addr[0], sizeof(int));
+	memcpy(&port, &addr->addr[4], sizeof(short));
+	putLE(p, (uint32_t)id, 4);
+	putLE(p + 4, (uint16_t)port, 2);
+}
+
+static void readAddr(const unsigned char *p, Address *addr) {
+	int id = (int)(uint32_t)getLE(p, 4);
+	short port = (short)(uint16_t)getLE(p + 4, 2);
+	memcpy(&addr->addr[0], &id, sizeof(int));
+	memcpy(&addr->addr[4], &port, sizeof(short));
+}
+
+/**
+ * FUNCTION NAME: memberEntrySize
+ *
+ * DESCRIPTION: Encoded size of a MEMBERS entry following an entry with id previd
+ */
+int memberEntrySize(const MemberListEntry &mle, long previd) {
+	return varintSize(zigzag(mle.id - previd)) + varintSize((uint16_t)mle.port) + varintSize(zigzag(mle.heartbeat));
+}
+
+/**
+ * FUNCTION NAME: storeSize
+ *
+ * DESCRIPTION: Encoded size of a MEMBERS field taken from the columns of a MemberStore
+ */
+static int storeSize(const MemberStore *store) {
+	int n = store->size();
+	int size = varintSize(n);
+	long previd = 0;
+
+	for ( int r = 0; r < n; r++ ) {
+		size += varintSize(zigzag(store->getid(r) - previd)) + varintSize((uint16_t)store->getport(r)) + varintSize(zigzag(store->getheartbeat(r)));
+		previd = store->getid(r);
+	}
+	return size;
+}
+
+/**
+ * FUNCTION NAME: putStore
+ *
+ * DESCRIPTION: Encode a MEMBERS field from the columns of a MemberStore
+ */
+static unsigned char *putStore(unsigned char *p, const MemberStore *store) {
+	int n = store->size();
+	long previd = 0;
+
+	p = putVarint(p, n);
+	for ( int r = 0; r < n; r++ ) {
+		p = putVarint(p, zigzag(store->getid(r) - previd));
+		p = putVarint(p, (uint16_t)store->getport(r));
+		p = putVarint(p, zigzag(store->getheartbeat(r)));
+		previd = store->getid(r);
+	}
+	return p;
+}
+
+/**
+ * FUNCTION NAME: next
+ *
+ * DESCRIPTION: Decode the next address of the list
+ */
+bool AddrIter::next(Address *addr) {
+	if ( remaining <= 0 ) {
+		return false;
+	}
+	readAddr(p, addr);
+	p += WIRE_ADDR_SIZE;
+	remaining--;
+	return true;
+}
+
+/**
+ * FUNCTION NAME: next
+ *
+ * DESCRIPTION: Decode the next member entry.  The timestamp is left for the caller to set.
+ */
+bool MemberIter::next(MemberListEntry *mle) {
+	uint64_t v;
+
+	if ( remaining <= 0 ) {
+		return false;
+	}
+	getVarint(&p, end, &v);
+	previd += unzigzag(v);
+	mle->setid((int)previd);
+	getVarint(&p, end, &v);
+	mle->setport((short)v);
+	getVarint(&p, end, &v);
+	mle->setheartbeat((long)unzigzag(v));
+	remaining--;
+	return true;
+}
+
+/**
+ * FUNCTION NAME: next
+ *
+ * DESCRIPTION: Decode the next value of the list
+ */
+bool UintIter::next(unsigned long *v) {
+	uint64_t u;
+
+	if ( remaining <= 0 ) {
+		return false;
+	}
+	getVarint(&p, end, &u);
+	*v = (unsigned long)u;
+	remaining--;
+	return true;
+}
+
+/**
+ * FUNCTION NAME: parse
+ *
+ * DESCRIPTION: Validate the message and record where each field starts
+ *
+ * RETURNS:
+ * false if the message is truncated, of an unknown version or of an unknown type
+ */
+bool MsgView::parse(const char *buf, int len) {
+	const unsigned char *p, *end;
+	const int *schema;
+	uint64_t v;
+	int f, i, type;
+
+	this->data = (const unsigned char *)buf;
+	this->size = len;
+	for ( f = 0; f < NUM_MSG_FIELDS; f++ ) {
+		field[f] = NULL;
+		count[f] = 0;
+		value[f] = 0;
+	}
+
+	if ( len < MSG_HDR_SIZE || data[0] != WIRE_VERSION ) {
+		return false;
+	}
+	type = data[1];
+	if ( type >= DUMMYLASTMSGTYPE ) {
+		return false;
+	}
+
+	p = data + MSG_HDR_SIZE;
+	end = data + len;
+	for ( schema = schemas[type]; *schema >= 0; schema++ ) {
+		f = *schema;
+		switch ( fieldKinds[f] ) {
+			case KIND_ADDR:
+				if ( end - p < WIRE_ADDR_SIZE ) {
+					return false;
+				}
+				field[f] = p;
+				count[f] = 1;
+				p += WIRE_ADDR_SIZE;
+				break;
+			case KIND_ADDRLIST:
+				if ( !getVarint(&p, end, &v) || v > (uint64_t)(end - p) / WIRE_ADDR_SIZE ) {
+					return false;
+				}
+				field[f] = p;
+				count[f] = (int)v;
+				p += v * WIRE_ADDR_SIZE;
+				break;
+			case KIND_MEMBERS:
+				// Every entry takes at least three bytes
+				if ( !getVarint(&p, end, &v) || v > (uint64_t)(end - p) / 3 ) {
+					return false;
+				}
+				field[f] = p;
+				count[f] = (int)v;
+				for ( i = 0; i < 3 * count[f]; i++ ) {
+					if ( !getVarint(&p, end, &v) ) {
+						return false;
+					}
+				}
+				break;
+			case KIND_UINT:
+				field[f] = p;
+				if ( !getVarint(&p, end, &v) ) {
+					return false;
+				}
+				value[f] = (unsigned long)v;
+				break;
+			case KIND_UINTLIST:
+				// Every value takes at least one byte
+				if ( !getVarint(&p, end, &v) || v > (uint64_t)(end - p) ) {
+					return false;
+				}
+				field[f] = p;
+				count[f] = (int)v;
+				for ( i = 0; i < count[f]; i++ ) {
+					if ( !getVarint(&p, end, &v) ) {
+						return false;
+					}
+				}
+				break;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * FUNCTION NAME: getType
+ *
+ * DESCRIPTION: getter
+ */
+MsgTypes MsgView::getType() {
+	return (MsgTypes)data[1];
+}
+
+/**
+ * FUNCTION NAME: getFrom
+ *
+ * DESCRIPTION: Address of the sender
+ */
+Address MsgView::getFrom() {
+	Address addr;
+	readAddr(data + 2, &addr);
+	return addr;
+}
+
+/**
+ * FUNCTION NAME: getHeartbeat
+ *
+ * DESCRIPTION: Heartbeat of the sender
+ */
+long MsgView::getHeartbeat() {
+	return (long)(int64_t)getLE(data + 8, 8);
+}
+
+/**
+ * FUNCTION NAME: has
+ *
+ * DESCRIPTION: True if the field is part of this message
+ */
+bool MsgView::has(MsgField f) {
+	return field[f] != NULL;
+}
+
+/**
+ * FUNCTION NAME: getAddr
+ *
+ * DESCRIPTION: Value of an ADDR field, or the null address if absent
+ */
+Address MsgView::getAddr(MsgField f) {
+	Address addr;
+	addr.init();
+	if ( field[f] != NULL ) {
+		readAddr(field[f], &addr);
+	}
+	return addr;
+}
+
+/**
+ * FUNCTION NAME: getUint
+ *
+ * DESCRIPTION: Value of a UINT field, or 0 if absent
+ */
+unsigned long MsgView::getUint(MsgField f) {
+	return value[f];
+}
+
+/**
+ * FUNCTION NAME: getAddrs
+ *
+ * DESCRIPTION: Iterator over an ADDRLIST field
+ */
+AddrIter MsgView::getAddrs(MsgField f) {
+	return AddrIter(field[f], count[f]);
+}
+
+/**
+ * FUNCTION NAME: getMembers
+ *
+ * DESCRIPTION: Iterator over a MEMBERS field
+ */
+MemberIter MsgView::getMembers(MsgField f) {
+	return MemberIter(field[f], data + size, count[f]);
+}
+
+/**
+ * FUNCTION NAME: getUints
+ *
+ * DESCRIPTION: Iterator over a UINTLIST field
+ */
+UintIter MsgView::getUints(MsgField f) {
+	return UintIter(field[f], data + size, count[f]);
+}
+
+/**
+ * FUNCTION NAME: getCount
+ *
+ * DESCRIPTION: Number of entries of a list field
+ */
+int MsgView::getCount(MsgField f) {
+	return count[f];
+}
+
+/**
+ * Constructor
+ */
+MsgBuilder::MsgBuilder(MsgTypes type, Address *from, long heartbeat): type(type), from(*from), heartbeat(heartbeat) {
+	for ( int f = 0; f < NUM_MSG_FIELDS; f++ ) {
+		addr[f].init();
+		addrs[f] = NULL;
+		members[f] = NULL;
+		stores[f] = NULL;
+		uints[f] = NULL;
+		count[f] = 0;
+		value[f] = 0;
+	}
+}
+
+/**
+ * FUNCTION NAME: setAddr
+ *
+ * DESCRIPTION: setter
+ */
+MsgBuilder& MsgBuilder::setAddr(MsgField f, Address *a) {
+	addr[f] = *a;
+	return *this;
+}
+
+/**
+ * FUNCTION NAME: setAddrs
+ *
+ * DESCRIPTION: setter
+ */
+MsgBuilder& MsgBuilder::setAddrs(MsgField f, const Address *list, int n) {
+	addrs[f] = list;
+	count[f] = n;
+	return *this;
+}
+
+/**
+ * FUNCTION NAME: setMembers
+ *
+ * DESCRIPTION: setter
+ */
+MsgBuilder& MsgBuilder::setMembers(MsgField f, const vector<MemberListEntry> *ml) {
+	members[f] = ml;
+	stores[f] = NULL;
+	return *this;
+}
+
+/**
+ * FUNCTION NAME: setMembers
+ *
+ * DESCRIPTION: setter; the entries are encoded straight from the store's columns
+ */
+MsgBuilder& MsgBuilder::setMembers(MsgField f, const MemberStore *store) {
+	stores[f] = store;
+	members[f] = NULL;
+	return *this;
+}
+
+/**
+ * FUNCTION NAME: setUint
+ *
+ * DESCRIPTION: setter
+ */
+MsgBuilder& MsgBuilder::setUint(MsgField f, unsigned long v) {
+	value[f] = v;
+	return *this;
+}
+
+/**
+ * FUNCTION NAME: setUints
+ *
+ * DESCRIPTION: setter
+ */
+MsgBuilder& MsgBuilder::setUints(MsgField f, const unsigned long *list, int n) {
+	uints[f] = list;
+	count[f] = n;
+	return *this;
+}
+
+/**
+ * FUNCTION NAME: encodedSize
+ *
+ * DESCRIPTION: Number of bytes encode() will write
+ */
+int MsgBuilder::encodedSize() {
+	const int *schema;
+	int size = MSG_HDR_SIZE;
+	long previd;
+	int f, i;
+
+	for ( schema = schemas[type]; *schema >= 0; schema++ ) {
+		f = *schema;
+		switch ( fieldKinds[f] ) {
+			case KIND_ADDR:
+				size += WIRE_ADDR_SIZE;
+				break;
+			case KIND_ADDRLIST:
+				size += varintSize(count[f]) + count[f] * WIRE_ADDR_SIZE;
+				break;
+			case KIND_MEMBERS:
+				if ( stores[f] != NULL ) {
+					size += storeSize(stores[f]);
+					break;
+				}
+				if ( members[f] == NULL ) {
+					size += 1;
+					break;
+				}
+				size += varintSize(members[f]->size());
+				previd = 0;
+				for ( vector<MemberListEntry>::const_iterator it = members[f]->begin(); it != members[f]->end(); it++ ) {
+					size += memberEntrySize(*it, previd);
+					previd = it->id;
+				}
+				break;
+			case KIND_UINT:
+				size += varintSize(value[f]);
+				break;
+			case KIND_UINTLIST:
+				size += varintSize(count[f]);
+				for ( i = 0; i < count[f]; i++ ) {
+					size += varintSize(uints[f][i]);
+				}
+				break;
+		}
+	}
+
+	return size;
+}
+
+/**
+ * FUNCTION NAME: encode
+ *
+ * DESCRIPTION: Write the message into buf.  size is encodedSize() when the caller has
+ *              already computed it, -1 otherwise.
+ *
+ * RETURNS:
+ * number of bytes written, or -1 if cap is too small
+ */
+int MsgBuilder::encode(char *buf, int cap, int size) {
+	unsigned char *p = (unsigned char *)buf;
+	const int *schema;
+	long previd;
+	int f, i;
+
+	if ( size < 0 ) {
+		size = encodedSize();
+	}
+	if ( size > cap ) {
+		return -1;
+	}
+
+	p[0] = WIRE_VERSION;
+	p[1] = (unsigned char)type;
+	writeAddr(p + 2, &from);
+	putLE(p + 8, (uint64_t)(int64_t)heartbeat, 8);
+	p += MSG_HDR_SIZE;
+
+	for ( schema = schemas[type]; *schema >= 0; schema++ ) {
+		f = *schema;
+		switch ( fieldKinds[f] ) {
+			case KIND_ADDR:
+				writeAddr(p, &addr[f]);
+				p += WIRE_ADDR_SIZE;
+				break;
+			case KIND_ADDRLIST:
+				p = putVarint(p, count[f]);
+				for ( i = 0; i < count[f]; i++ ) {
+					writeAddr(p, &addrs[f][i]);
+					p += WIRE_ADDR_SIZE;
+				}
+				break;
+			case KIND_MEMBERS:
+				if ( stores[f] != NULL ) {
+					p = putStore(p, stores[f]);
+					break;
+				}
+				if ( members[f] == NULL ) {
+					p = putVarint(p, 0);
+					break;
+				}
+				p = putVarint(p, members[f]->size());
+				previd = 0;
+				for ( vector<MemberListEntry>::const_iterator it = members[f]->begin(); it != members[f]->end(); it++ ) {
+					p = putVarint(p, zigzag(it->id - previd));
+					p = putVarint(p, (uint16_t)it->port);
+					p = putVarint(p, zigzag(it->heartbeat));
+					previd = it->id;
+				}
+				break;
+			case KIND_UINT:
+				p = putVarint(p, value[f]);
+				break;
+			case KIND_UINTLIST:
+				p = putVarint(p, count[f]);
+				for ( i = 0; i < count[f]; i++ ) {
+					p = putVarint(p, uints[f][i]);
+				}
+				break;
+		}
+	}
+
+	return (int)(p - (unsigned char *)buf);
+}
+
+/**
+ * Constructor
+ */
+MsgBatch::MsgBatch(): n(0), first(0), firstLen(0) {
+	clear();
+}
+
+/**
+ * FUNCTION NAME: append
+ *
+ * DESCRIPTION: Add a message of len bytes (its encodedSize()) to the frame
+ *
+ * RETURNS:
+ * false if the frame would grow beyond cap bytes; the frame is left unchanged
+ */
+bool MsgBatch::append(MsgBuilder *msg, int len, int cap) {
+	int off = buf.size();
+	unsigned char *p;
+
+	if ( off + varintSize(len) + len > cap ) {
+		return false;
+	}
+
+	buf.resize(off + varintSize(len) + len);
+	p = putVarint((unsigned char *)&buf[off], len);
+	msg->encode((char *)p, len, len);
+
+	if ( n == 0 ) {
+		first = (char *)p - &buf[0];
+		firstLen = len;
+	}
+	n++;
+	putLE((unsigned char *)&buf[2], n, 2);
+	return true;
+}
+
+/**
+ * FUNCTION NAME: data
+ *
+ * DESCRIPTION: Bytes to send.  A frame holding a single message is sent as that plain
+ *              message, without the batch framing.
+ */
+const char *MsgBatch::data() {
+	return n == 1 ? &buf[first] : &buf[0];
+}
+
+/**
+ * FUNCTION NAME: size
+ *
+ * DESCRIPTION: Number of bytes to send
+ */
+int MsgBatch::size() {
+	return n == 1 ? firstLen : (int)buf.size();
+}
+
+/**
+ * FUNCTION NAME: clear
+ *
+ * DESCRIPTION: Empty the frame, keeping its buffer
+ */
+void MsgBatch::clear() {
+	buf.resize(BATCH_HDR_SIZE);
+	buf[0] = WIRE_VERSION;
+	buf[1] = (char)BATCH_FRAME;
+	buf[2] = buf[3] = 0;
+	n = 0;
+}
+
+/**
+ * FUNCTION NAME: open
+ *
+ * DESCRIPTION: Start reading a received frame
+ *
+ * RETURNS:
+ * true if the frame is a batch of several messages
+ */
+bool FrameReader::open(const char *data, int size) {
+	p = (const unsigned char *)data;
+	end = p + size;
+
+	batch = size >= BATCH_HDR_SIZE && p[0] == WIRE_VERSION && p[1] == BATCH_FRAME;
+	if ( batch ) {
+		remaining = (int)getLE(p + 2, 2);
+		p += BATCH_HDR_SIZE;
+	}
+	else {
+		remaining = 1;
+	}
+	return batch;
+}
+
+/**
+ * FUNCTION NAME: next
+ *
+ * DESCRIPTION: Return the next message of the frame
+ *
+ * RETURNS:
+ * false once the frame is exhausted or a length runs past its end
+ */
+bool FrameReader::next(const char **msg, int *size) {
+	uint64_t len;
+
+	if ( remaining <= 0 ) {
+		return false;
+	}
+	remaining--;
+
+	if ( !batch ) {
+		*msg = (const char *)p;
+		*size = (int)(end - p);
+		return true;
+	}
+
+	if ( !getVarint(&p, end, &len) || len > (uint64_t)(end - p) ) {
+		remaining = 0;
+		return false;
+	}
+	*msg = (const char *)p;
+	*size = (int)len;
+	p += len;
+	return true;
+}
@@ -0,0 +1,279 @@
+/**********************************
+ * FILE NAME: Codec.h
+ *
+ * DESCRIPTION: Wire format of the membership protocol messages.
+ * 				Header file of MsgBuilder and MsgView classes.
+ **********************************/
+
+#ifndef _CODEC_H_
+#define _CODEC_H_
+
+#include "stdincludes.h"
+#include "Member.h"
+#include "MemberStore.h"
+
+/*
+ * Macros
+ */
+#define WIRE_VERSION 1
+// version(1) type(1) id(4) port(2) heartbeat(8)
+#define MSG_HDR_SIZE 16
+#define WIRE_ADDR_SIZE 6
+// Type byte of a frame carrying several messages: version(1) BATCH_FRAME(1) count(u16 LE),
+// then per message a varint length followed by the message itself
+#define BATCH_FRAME 0xff
+#define BATCH_HDR_SIZE 4
+
+/*
+ * Message schema
+ *
+ * Every message starts with the fixed-width little-endian header above.  The body is
+ * the list of fields given by <TYPE>_SCHEMA, in order.  Field kinds:
+ *   ADDR     - id (u32 LE) and port (u16 LE)
+ *   ADDRLIST - varint count, then count ADDRs
+ *   MEMBERS  - varint count, then per entry: zigzag varint id delta from the previous
+ *              entry, varint port, varint heartbeat
+ *   UINT     - varint
+ *   UINTLIST - varint count, then count varints
+ *
+ * To add a message type or field, extend MSG_TYPES / MSG_FIELDS and the schema lists;
+ * the encoder and decoder are driven entirely by these tables.
+ */
+#define MSG_TYPES(M) \
+	M(JOINREQ) \
+	M(JOINREP) \
+	M(PING) \
+	M(INDPING) \
+	M(PINGREP) \
+	M(INDPINGREP) \
+	M(JOINED) \
+	M(FAILED) \
+	M(FORWARDJOIN) \
+	M(NEIGHBOR) \
+	M(NEIGHBORREP) \
+	M(DISCONNECT) \
+	M(SHUFFLE) \
+	M(SHUFFLEREP) \
+	M(DIGEST) \
+	M(DIGESTREP) \
+	M(DIGESTPUSH) \
+	M(LEAVE) \
+	M(HEARTBEAT)
+
+#define MSG_FIELDS(F) \
+	F(members, KIND_MEMBERS) \
+	F(failed, KIND_ADDRLIST) \
+	F(target, KIND_ADDR) \
+	F(origin, KIND_ADDR) \
+	F(fragment, KIND_UINT) \
+	F(fragments, KIND_UINT) \
+	F(total, KIND_UINT) \
+	F(ttl, KIND_UINT) \
+	F(priority, KIND_UINT) \
+	F(accept, KIND_UINT) \
+	F(nodes, KIND_ADDRLIST) \
+	F(digest, KIND_UINTLIST) \
+	F(buckets, KIND_UINTLIST) \
+	F(left, KIND_ADDRLIST) \
+	F(trace, KIND_UINT)
+
+#define JOINREQ_SCHEMA(F)    F(origin) F(ttl)
+#define JOINREP_SCHEMA(F)    F(fragment) F(fragments) F(total) F(members)
+#define PING_SCHEMA(F)       F(members) F(failed) F(left) F(trace)
+#define INDPING_SCHEMA(F)    F(target) F(origin) F(failed) F(trace)
+#define PINGREP_SCHEMA(F)    F(failed) F(left) F(trace)
+#define INDPINGREP_SCHEMA(F) F(target) F(origin) F(failed) F(trace)
+#define JOINED_SCHEMA(F)
+#define FAILED_SCHEMA(F)
+#define FORWARDJOIN_SCHEMA(F) F(target) F(ttl)
+#define NEIGHBOR_SCHEMA(F)    F(priority)
+#define NEIGHBORREP_SCHEMA(F) F(accept)
+#define DISCONNECT_SCHEMA(F)
+#define SHUFFLE_SCHEMA(F)     F(origin) F(ttl) F(nodes)
+#define SHUFFLEREP_SCHEMA(F)  F(nodes)
+#define DIGEST_SCHEMA(F)      F(digest)
+#define DIGESTREP_SCHEMA(F)   F(buckets) F(members)
+#define DIGESTPUSH_SCHEMA(F)  F(members)
+#define LEAVE_SCHEMA(F)
+#define HEARTBEAT_SCHEMA(F)   F(members) F(left)
+
+/**
+ * Message Types
+ */
+#define MSG_TYPE_ENUM(name) name,
+enum MsgTypes{
+	MSG_TYPES(MSG_TYPE_ENUM)
+	DUMMYLASTMSGTYPE
+};
+#undef MSG_TYPE_ENUM
+
+/**
+ * Message fields and their kinds
+ */
+enum FieldKind { KIND_ADDR, KIND_ADDRLIST, KIND_MEMBERS, KIND_UINT, KIND_UINTLIST };
+
+#define MSG_FIELD_ENUM(name, kind) FIELD_##name,
+enum MsgField {
+	MSG_FIELDS(MSG_FIELD_ENUM)
+	NUM_MSG_FIELDS
+};
+#undef MSG_FIELD_ENUM
+
+const char *msgTypeName(int type);
+int memberEntrySize(const MemberListEntry &mle, long previd);
+
+/**
+ * CLASS NAME: AddrIter
+ *
+ * DESCRIPTION: Iterates over an ADDRLIST field in place
+ */
+class AddrIter {
+private:
+	const unsigned char *p;
+	int remaining;
+public:
+	AddrIter(): p(NULL), remaining(0) {}
+	AddrIter(const unsigned char *p, int count): p(p), remaining(count) {}
+	bool next(Address *addr);
+	int left() { return remaining; }
+};
+
+/**
+ * CLASS NAME: MemberIter
+ *
+ * DESCRIPTION: Decodes a MEMBERS field in place, one entry at a time.  The view has
+ *              already validated the field so next() cannot run off the buffer.
+ */
+class MemberIter {
+private:
+	const unsigned char *p;
+	const unsigned char *end;
+	int remaining;
+	long previd;
+public:
+	MemberIter(): p(NULL), end(NULL), remaining(0), previd(0) {}
+	MemberIter(const unsigned char *p, const unsigned char *end, int count): p(p), end(end), remaining(count), previd(0) {}
+	bool next(MemberListEntry *mle);
+	int left() { return remaining; }
+};
+
+/**
+ * CLASS NAME: UintIter
+ *
+ * DESCRIPTION: Decodes a UINTLIST field in place
+ */
+class UintIter {
+private:
+	const unsigned char *p;
+	const unsigned char *end;
+	int remaining;
+public:
+	UintIter(): p(NULL), end(NULL), remaining(0) {}
+	UintIter(const unsigned char *p, const unsigned char *end, int count): p(p), end(end), remaining(count) {}
+	bool next(unsigned long *v);
+	int left() { return remaining; }
+};
+
+/**
+ * CLASS NAME: MsgView
+ *
+ * DESCRIPTION: Zero-copy reader over a received message.  parse() checks the version,
+ *              the type and every field of the schema against the buffer size; the
+ *              accessors then read straight out of the buffer, which must outlive the view.
+ */
+class MsgView {
+private:
+	const unsigned char *data;
+	int size;
+	const unsigned char *field[NUM_MSG_FIELDS];
+	int count[NUM_MSG_FIELDS];
+	unsigned long value[NUM_MSG_FIELDS];
+public:
+	MsgView(): data(NULL), size(0) {}
+	bool parse(const char *data, int size);
+	MsgTypes getType();
+	Address getFrom();
+	long getHeartbeat();
+	bool has(MsgField f);
+	Address getAddr(MsgField f);
+	unsigned long getUint(MsgField f);
+	AddrIter getAddrs(MsgField f);
+	MemberIter getMembers(MsgField f);
+	UintIter getUints(MsgField f);
+	int getCount(MsgField f);
+};
+
+/**
+ * CLASS NAME: MsgBuilder
+ *
+ * DESCRIPTION: Collects the fields of one message and encodes them in schema order.
+ *              Fields of the schema that were not set are encoded empty/zero; fields that
+ *              are not part of the schema are ignored.  Lists are referenced, not copied,
+ *              so they must stay alive until encode() is called.
+ */
+class MsgBuilder {
+private:
+	MsgTypes type;
+	Address from;
+	long heartbeat;
+	Address addr[NUM_MSG_FIELDS];
+	const Address *addrs[NUM_MSG_FIELDS];
+	const vector<MemberListEntry> *members[NUM_MSG_FIELDS];
+	const MemberStore *stores[NUM_MSG_FIELDS];
+	const unsigned long *uints[NUM_MSG_FIELDS];
+	int count[NUM_MSG_FIELDS];
+	unsigned long value[NUM_MSG_FIELDS];
+public:
+	MsgBuilder(MsgTypes type, Address *from, long heartbeat);
+	MsgTypes getType() { return type; }
+	MsgBuilder& setAddr(MsgField f, Address *a);
+	MsgBuilder& setAddrs(MsgField f, const Address *list, int n);
+	MsgBuilder& setMembers(MsgField f, const vector<MemberListEntry> *ml);
+	MsgBuilder& setMembers(MsgField f, const MemberStore *store);
+	MsgBuilder& setUint(MsgField f, unsigned long v);
+	MsgBuilder& setUints(MsgField f, const unsigned long *list, int n);
+	int encodedSize();
+	int encode(char *buf, int cap, int size = -1);
+};
+
+/**
+ * CLASS NAME: MsgBatch
+ *
+ * DESCRIPTION: Outbound frame collecting every message for one destination.  Messages
+ *              are encoded straight into the frame buffer, which is reused when a full
+ *              frame is sent before the end of the tick.
+ */
+class MsgBatch {
+private:
+	vector<char> buf;
+	int n;
+	int first;
+	int firstLen;
+public:
+	MsgBatch();
+	bool append(MsgBuilder *msg, int len, int cap);
+	int count() { return n; }
+	const char *data();
+	int size();
+	void clear();
+};
+
+/**
+ * CLASS NAME: FrameReader
+ *
+ * DESCRIPTION: Splits a received frame into its messages.  A buffer that is not a batch
+ *              frame is returned as a single message.
+ */
+class FrameReader {
+private:
+	const unsigned char *p;
+	const unsigned char *end;
+	int remaining;
+	bool batch;
+public:
+	FrameReader(): p(NULL), end(NULL), remaining(0), batch(false) {}
+	bool open(const char *data, int size);
+	bool next(const char **msg, int *size);
+};
+
+#endif /* _CODEC_H_ */
@@ -12,17 +12,17 @@
 EmulNet::EmulNet(Params *p)
 {
 	//trace.funcEntry("EmulNet::EmulNet");
-	int i,j;
+	TrafficCount zero = { 0, 0 };
 	par = p;
 	emulnet.setNextId(1);
 	emulnet.settCurrBuffSize(0);
 	enInited=0;
-	for ( i = 0; i < MAX_NODES; i++ ) {
-		for ( j = 0; j < MAX_TIME; j++ ) {
-			sent_msgs[i][j] = 0;
-			recv_msgs[i][j] = 0;
-		}
-	}
+	sent_msgs.resize(par->EN_GPSZ + 1);
+	recv_msgs.resize(par->EN_GPSZ + 1);
+	traffic.assign((long) (par->EN_GPSZ + 1) * NUM_TRAFFIC_TYPES * NUM_TRAFFIC_OUTCOMES, zero);
+	memset(trafficTotal, 0, sizeof(trafficTotal));
+	matrixPeriodStart = 0;
+	matrixFile = NULL;
 	//trace.funcExit("EmulNet::EmulNet", SUCCESS);
 }
 
@@ -30,15 +30,16 @@ EmulNet::EmulNet(Params *p)
  * Copy constructor
  */
 EmulNet::EmulNet(EmulNet &anotherEmulNet) {
-	int i, j;
 	this->par = anotherEmulNet.par;
 	this->enInited = anotherEmulNet.enInited;
-	for ( i = 0; i < MAX_NODES; i++ ) {
-		for ( j = 0; j < MAX_TIME; j++ ) {
-			this->sent_msgs[i][j] = anotherEmulNet.sent_msgs[i][j];
-			this->recv_msgs[i][j] = anotherEmulNet.recv_msgs[i][j];
-		}
-	}
+	this->sent_msgs = anotherEmulNet.sent_msgs;
+	this->recv_msgs = anotherEmulNet.recv_msgs;
+	this->traffic = anotherEmulNet.traffic;
+	memcpy(this->trafficTotal, anotherEmulNet.trafficTotal, sizeof(trafficTotal));
+	this->matrix = anotherEmulNet.matrix;
+	this->matrixPeriod = anotherEmulNet.matrixPeriod;
+	this->matrixPeriodStart = anotherEmulNet.matrixPeriodStart;
+	this->matrixFile = NULL;
 	this->emulnet = anotherEmulNet.emulnet;
 }
 
@@ -46,15 +47,15 @@ EmulNet::EmulNet(EmulNet &anotherEmulNet) {
  * Assignment operator overloading
  */
 EmulNet& EmulNet::operator =(EmulNet &anotherEmulNet) {
-	int i, j;
 	this->par = anotherEmulNet.par;
 	this->enInited = anotherEmulNet.enInited;
-	for ( i = 0; i < MAX_NODES; i++ ) {
-		for ( j = 0; j < MAX_TIME; j++ ) {
-			this->sent_msgs[i][j] = anotherEmulNet.sent_msgs[i][j];
-			this->recv_msgs[i][j] = anotherEmulNet.recv_msgs[i][j];
-		}
-	}
+	this->sent_msgs = anotherEmulNet.sent_msgs;
+	this->recv_msgs = anotherEmulNet.recv_msgs;
+	this->traffic = anotherEmulNet.traffic;
+	memcpy(this->trafficTotal, anotherEmulNet.trafficTotal, sizeof(trafficTotal));
+	this->matrix = anotherEmulNet.matrix;
+	this->matrixPeriod = anotherEmulNet.matrixPeriod;
+	this->matrixPeriodStart = anotherEmulNet.matrixPeriodStart;
 	this->emulnet = anotherEmulNet.emulnet;
 	return *this;
 }
@@ -64,6 +65,27 @@ EmulNet& EmulNet::operator =(EmulNet &anotherEmulNet) {
  */
 EmulNet::~EmulNet() {}
 
+/**
+ * FUNCTION NAME: countTick
+ *
+ * DESCRIPTION: Count a message in a node's row of sent_msgs or recv_msgs
+ */
+static void countTick(vector<int> &row, int time) {
+	if ( (int) row.size() <= time ) {
+		row.resize(time + 1, 0);
+	}
+	row[time]++;
+}
+
+/**
+ * FUNCTION NAME: tickCount
+ *
+ * DESCRIPTION: Messages of a node's row in a tick
+ */
+static int tickCount(const vector<int> &row, int time) {
+	return time < (int) row.size() ? row[time] : 0;
+}
+
 /**
  * FUNCTION NAME: ENinit
  *
@@ -89,29 +111,48 @@ int EmulNet::ENsend(Address *myaddr, Address *toaddr, char *data, int size) {
 	static char temp[2048];
 	int sendmsg = rand() % 100;
 
-	if( (emulnet.currbuffsize >= ENBUFFSIZE) || (size + (int)sizeof(en_msg) >= par->MAX_MSG_SIZE) || (par->dropmsg && sendmsg < (int) (par->MSG_DROP_PROB * 100)) ) {
+	int src = *(int *)(myaddr->addr);
+	int time = par->getcurrtime();
+
+	assert(src <= par->EN_GPSZ);
+	assert(time < MAX_TIME);
+
+	countTraffic(src, data, size, TRAFFIC_SENT);
+	MP1_PROBE4(en_send, src, *(int *)(toaddr->addr), size, size > 1 ? (int)(unsigned char)data[1] : -1);
+	if( emulnet.currbuffsize >= ENBUFFSIZE ) {
+		countTraffic(src, data, size, TRAFFIC_DROP_FULL);
+		MP1_PROBE4(en_drop, src, *(int *)(toaddr->addr), size, (int)TRAFFIC_DROP_FULL);
+		return 0;
+	}
+	if( size + (int)sizeof(en_msg) >= par->MAX_MSG_SIZE ) {
+		countTraffic(src, data, size, TRAFFIC_DROP_SIZE);
+		MP1_PROBE4(en_drop, src, *(int *)(toaddr->addr), size, (int)TRAFFIC_DROP_SIZE);
+		return 0;
+	}
+	if( par->dropmsg && sendmsg < (int) (par->MSG_DROP_PROB * 100) ) {
+		countTraffic(src, data, size, TRAFFIC_DROP_PROB);
+		MP1_PROBE4(en_drop, src, *(int *)(toaddr->addr), size, (int)TRAFFIC_DROP_PROB);
 		return 0;
 	}
 
-	em = (en_msg *)malloc(sizeof(en_msg) + size);
+	em = (en_msg *)malloc(sizeof(en_msg) + sizeof(en_payload) + size);
 	em->size = size;
+	em->shared = (en_payload *)(em + 1);
+	em->shared->refs = 1;
+	em->shared->size = size;
+	em->shared->block = em;
 
 	memcpy(&(em->from.addr), &(myaddr->addr), sizeof(em->from.addr));
 	memcpy(&(em->to.addr), &(toaddr->addr), sizeof(em->from.addr));
-	memcpy(em + 1, data, size);
+	memcpy(em->shared + 1, data, size);
 
 	emulnet.buff[emulnet.currbuffsize++] = em;
 
-	int src = *(int *)(myaddr->addr);
-	int time = par->getcurrtime();
-
-	assert(src <= MAX_NODES);
-	assert(time < MAX_TIME);
-
-	sent_msgs[src][time]++;
+	countTick(sent_msgs[src], time);
+	countLink(src, *(int *)(toaddr->addr), data, size);
 
 	#ifdef DEBUGLOG
-		sprintf(temp, "Sending 4+%d B msg type %d to %d.%d.%d.%d:%d ", size-4, *(int *)data, toaddr->addr[0], toaddr->addr[1], toaddr->addr[2], toaddr->addr[3], *(short *)&toaddr->addr[4]);
+		sprintf(temp, "Sending %d B msg type %d to %d.%d.%d.%d:%d ", size, (int)(unsigned char)data[1], toaddr->addr[0], toaddr->addr[1], toaddr->addr[2], toaddr->addr[3], *(short *)&toaddr->addr[4]);
 	#endif
 
 	return size;
@@ -133,10 +174,234 @@ int EmulNet::ENsend(Address *myaddr, Address *toaddr, string data) {
 	return ret;
 }
 
+/**
+ * FUNCTION NAME: addTraffic
+ *
+ * DESCRIPTION: Add to a node's counter and to the total over all nodes
+ */
+void EmulNet::addTraffic(int node, int type, int outcome, long msgs, long bytes) {
+	trafficAt(node, type, outcome).msgs += msgs;
+	trafficAt(node, type, outcome).bytes += bytes;
+	trafficTotal[type][outcome].msgs += msgs;
+	trafficTotal[type][outcome].bytes += bytes;
+}
+
+/**
+ * FUNCTION NAME: countTraffic
+ *
+ * DESCRIPTION: Count a packet under the types of the messages it carries.  A batch frame
+ *              is split into its messages; its header and length prefixes count as framing.
+ */
+void EmulNet::countTraffic(int node, const char *data, int size, int outcome) {
+	FrameReader frame;
+	const char *msg;
+	int len;
+	int type;
+	int carried = 0;
+	bool batch = frame.open(data, size);
+
+	while ( frame.next(&msg, &len) ) {
+		type = (len >= 2 && (unsigned char) msg[1] < DUMMYLASTMSGTYPE) ? (unsigned char) msg[1] : TRAFFIC_FRAMING;
+		addTraffic(node, type, outcome, 1, len);
+		carried += len;
+	}
+	if ( batch ) {
+		addTraffic(node, TRAFFIC_FRAMING, outcome, 1, size - carried);
+	}
+}
+
+/**
+ * FUNCTION NAME: countLink
+ *
+ * DESCRIPTION: Add a packet put on the network to the (src, dst) entry of the traffic
+ *              matrix.  Messages are counted one by one inside batch frames.
+ */
+void EmulNet::countLink(int src, int dst, const char *data, int size) {
+	FrameReader frame;
+	const char *msg;
+	int len;
+	int msgs = 0;
+	long key = ((long) src << 32) | (unsigned int) dst;
+
+	if ( !par->TRAFFIC_MATRIX ) {
+		return;
+	}
+
+	frame.open(data, size);
+	while ( frame.next(&msg, &len) ) {
+		msgs++;
+	}
+
+	TrafficCount &all = matrix[key];
+	all.msgs += msgs;
+	all.bytes += size;
+	TrafficCount &period = matrixPeriod[key];
+	period.msgs += msgs;
+	period.bytes += size;
+}
+
+/**
+ * FUNCTION NAME: heavier
+ *
+ * DESCRIPTION: Order of the matrix dump: most bytes first
+ */
+static bool heavier(const pair<long, TrafficCount> &a, const pair<long, TrafficCount> &b) {
+	return a.second.bytes > b.second.bytes || (a.second.bytes == b.second.bytes && a.first < b.first);
+}
+
+/**
+ * FUNCTION NAME: dumpMatrix
+ *
+ * DESCRIPTION: Write the TRAFFIC_TOPK heaviest links of a matrix to trafficmatrix.log
+ */
+void EmulNet::dumpMatrix(unordered_map<long, TrafficCount> &links, const char *what, long from) {
+	vector< pair<long, TrafficCount> > top(links.begin(), links.end());
+	long msgs = 0;
+	long bytes = 0;
+	int k = min((int) top.size(), max(0, par->TRAFFIC_TOPK));
+	int i;
+
+	if ( matrixFile == NULL ) {
+		matrixFile = fopen("trafficmatrix.log", "w");
+		if ( matrixFile == NULL ) {
+			return;
+		}
+	}
+
+	for ( i = 0; i < (int) top.size(); i++ ) {
+		msgs += top[i].second.msgs;
+		bytes += top[i].second.bytes;
+	}
+	partial_sort(top.begin(), top.begin() + k, top.end(), heavier);
+
+	fprintf(matrixFile, "%s, ticks %ld to %d: %ld msgs %ld B over %d links\n", what, from, par->getcurrtime(), msgs, bytes, (int) top.size());
+	for ( i = 0; i < k; i++ ) {
+		fprintf(matrixFile, "  %4d -> %4d %8ld msgs %10ld B %5.1f%%\n", (int) (top[i].first >> 32), (int) (top[i].first & 0xffffffff),
+				top[i].second.msgs, top[i].second.bytes, bytes ? 100.0 * top[i].second.bytes / bytes : 0.0);
+	}
+	fflush(matrixFile);
+}
+
+/**
+ * FUNCTION NAME: ENdumpMatrix
+ *
+ * DESCRIPTION: Dump the heaviest links since the last dump and start a new period
+ */
+void EmulNet::ENdumpMatrix() {
+	if ( !par->TRAFFIC_MATRIX ) {
+		return;
+	}
+	dumpMatrix(matrixPeriod, "period", matrixPeriodStart);
+	matrixPeriod.clear();
+	matrixPeriodStart = par->getcurrtime() + 1;
+}
+
+/**
+ * FUNCTION NAME: freeMsg
+ *
+ * DESCRIPTION: Free an undelivered message, and its payload once nothing references it
+ */
+static void freeMsg(en_msg *em) {
+	void *block = em->shared->block;
+
+	if ( --em->shared->refs == 0 ) {
+		free(block);
+	}
+	if ( block != em ) {
+		free(em);
+	}
+}
+
+/**
+ * FUNCTION NAME: ENrelease
+ *
+ * DESCRIPTION: Give back the payload ENrecv handed to the inbox, once it has been handled
+ */
+void EmulNet::ENrelease(char *data) {
+	en_payload *payload = (en_payload *)data - 1;
+
+	if ( --payload->refs == 0 ) {
+		free(payload->block);
+	}
+}
+
+/**
+ * FUNCTION NAME: ENmulticast
+ *
+ * DESCRIPTION: Send the same data to n recipients.  The payload is copied once and every
+ *              recipient gets a header referencing it; the drop probability and the buffer
+ *              limit still apply to each recipient on its own.
+ *
+ * RETURNS:
+ * number of recipients the message was sent to
+ */
+int EmulNet::ENmulticast(Address *myaddr, Address *toaddrs, int n, char *data, int size) {
+	en_payload *payload;
+	en_msg *em;
+	int sent = 0;
+	int src = *(int *)(myaddr->addr);
+	int time = par->getcurrtime();
+	int i;
+
+	assert(src <= par->EN_GPSZ);
+	assert(time < MAX_TIME);
+
+	if( size + (int)sizeof(en_msg) >= par->MAX_MSG_SIZE ) {
+		for ( i = 0; i < n; i++ ) {
+			countTraffic(src, data, size, TRAFFIC_SENT);
+			countTraffic(src, data, size, TRAFFIC_DROP_SIZE);
+			MP1_PROBE4(en_send, src, *(int *)(toaddrs[i].addr), size, size > 1 ? (int)(unsigned char)data[1] : -1);
+			MP1_PROBE4(en_drop, src, *(int *)(toaddrs[i].addr), size, (int)TRAFFIC_DROP_SIZE);
+		}
+		return 0;
+	}
+
+	payload = (en_payload *)malloc(sizeof(en_payload) + size);
+	payload->refs = 0;
+	payload->size = size;
+	payload->block = payload;
+	memcpy(payload + 1, data, size);
+
+	for ( i = 0; i < n; i++ ) {
+		countTraffic(src, data, size, TRAFFIC_SENT);
+		MP1_PROBE4(en_send, src, *(int *)(toaddrs[i].addr), size, size > 1 ? (int)(unsigned char)data[1] : -1);
+		if( emulnet.currbuffsize >= ENBUFFSIZE ) {
+			countTraffic(src, data, size, TRAFFIC_DROP_FULL);
+			MP1_PROBE4(en_drop, src, *(int *)(toaddrs[i].addr), size, (int)TRAFFIC_DROP_FULL);
+			continue;
+		}
+		if( par->dropmsg && rand() % 100 < (int) (par->MSG_DROP_PROB * 100) ) {
+			countTraffic(src, data, size, TRAFFIC_DROP_PROB);
+			MP1_PROBE4(en_drop, src, *(int *)(toaddrs[i].addr), size, (int)TRAFFIC_DROP_PROB);
+			continue;
+		}
+
+		em = (en_msg *)malloc(sizeof(en_msg));
+		em->size = size;
+		memcpy(&(em->from.addr), &(myaddr->addr), sizeof(em->from.addr));
+		memcpy(&(em->to.addr), &(toaddrs[i].addr), sizeof(em->to.addr));
+		em->shared = payload;
+		payload->refs++;
+
+		emulnet.buff[emulnet.currbuffsize++] = em;
+		countTick(sent_msgs[src], time);
+		countLink(src, *(int *)(toaddrs[i].addr), data, size);
+		sent++;
+	}
+
+	if ( payload->refs == 0 ) {
+		free(payload);
+	}
+
+	return sent;
+}
+
 /**
  * FUNCTION NAME: ENrecv
  *
- * DESCRIPTION: EmulNet receive function
+ * DESCRIPTION: EmulNet receive function.  The inbox gets the payload itself, not a copy:
+ *              the message's reference passes to it, and the node hands it back with
+ *              ENrelease() after its callback.
  *
  * RETURN:
  * 0
@@ -144,32 +409,37 @@ int EmulNet::ENsend(Address *myaddr, Address *toaddr, string data) {
 int EmulNet::ENrecv(Address *myaddr, int (* enq)(void *, char *, int), struct timeval *t, int times, void *queue){
 	// times is always assumed to be 1
 	int i;
-	char* tmp;
+	char* data;
 	int sz;
 	en_msg *emsg;
 
 	for( i = emulnet.currbuffsize - 1; i >= 0; i-- ) {
 		emsg = emulnet.buff[i];
 
-		if ( 0 == strcmp(emsg->to.addr, myaddr->addr) ) {
+		// Compare all six bytes: ids that are multiples of 256 start with a zero byte
+		if ( 0 == memcmp(emsg->to.addr, myaddr->addr, sizeof(emsg->to.addr)) ) {
 			sz = emsg->size;
-			tmp = (char *) malloc(sz * sizeof(char));
-			memcpy(tmp, (char *)(emsg+1), sz);
+			data = (char *)(emsg->shared + 1);
+			countTraffic(*(int *)(myaddr->addr), data, sz, TRAFFIC_DELIVERED);
+			MP1_PROBE3(en_recv, *(int *)(myaddr->addr), *(int *)(emsg->from.addr), sz);
 
 			emulnet.buff[i] = emulnet.buff[emulnet.currbuffsize-1];
 			emulnet.currbuffsize--;
 
-			(*enq)(queue, (char *)tmp, sz);
+			(*enq)(queue, data, sz);
 
-			free(emsg);
+			// The header of a multicast recipient is its own; a unicast is freed with its payload
+			if ( emsg->shared->block != emsg ) {
+				free(emsg);
+			}
 
 			int dst = *(int *)(myaddr->addr);
 			int time = par->getcurrtime();
 
-			assert(dst <= MAX_NODES);
+			assert(dst <= par->EN_GPSZ);
 			assert(time < MAX_TIME);
 
-			recv_msgs[dst][time]++;
+			countTick(recv_msgs[dst], time);
 		}
 	}
 
@@ -189,7 +459,7 @@ int EmulNet::ENcleanup() {
 	FILE* file = fopen("msgcount.log", "w+");
 
 	while(emulnet.currbuffsize > 0) {
-		free(emulnet.buff[--emulnet.currbuffsize]);
+		freeMsg(emulnet.buff[--emulnet.currbuffsize]);
 	}
 
 	for ( i = 1; i <= par->EN_GPSZ; i++ ) {
@@ -199,16 +469,16 @@ int EmulNet::ENcleanup() {
 
 		for (j = 0; j < par->getcurrtime(); j++) {
 
-			sent_total += sent_msgs[i][j];
-			recv_total += recv_msgs[i][j];
+			sent_total += tickCount(sent_msgs[i], j);
+			recv_total += tickCount(recv_msgs[i], j);
 			if (i != 67) {
-				fprintf(file, " (%4d, %4d)", sent_msgs[i][j], recv_msgs[i][j]);
+				fprintf(file, " (%4d, %4d)", tickCount(sent_msgs[i], j), tickCount(recv_msgs[i], j));
 				if (j % 10 == 9) {
 					fprintf(file, "\n         ");
 				}
 			}
 			else {
-				fprintf(file, "special %4d %4d %4d\n", j, sent_msgs[i][j], recv_msgs[i][j]);
+				fprintf(file, "special %4d %4d %4d\n", j, tickCount(sent_msgs[i], j), tickCount(recv_msgs[i], j));
 			}
 		}
 		fprintf(file, "\n");
@@ -216,5 +486,13 @@ int EmulNet::ENcleanup() {
 	}
 
 	fclose(file);
+
+	if ( par->TRAFFIC_MATRIX ) {
+		dumpMatrix(matrix, "whole run", 0);
+	}
+	if ( matrixFile != NULL ) {
+		fclose(matrixFile);
+		matrixFile = NULL;
+	}
 	return 0;
 }
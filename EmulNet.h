@@ -7,16 +7,51 @@
 #ifndef _EMULNET_H_
 #define _EMULNET_H_
 
-#define MAX_NODES 1000
 #define MAX_TIME 3600
 #define ENBUFFSIZE 30000
 
 #include "stdincludes.h"
 #include "Params.h"
 #include "Member.h"
+#include "Codec.h"
+#include "Probes.h"
 
 using namespace std;
 
+/*
+ * Traffic accounting: one slot per message type, and one for the batch frame headers and
+ * length prefixes (and for data that is not a message).  A sender's row counts what it
+ * sent and what the network dropped; a receiver's row counts what was delivered to it.
+ */
+#define TRAFFIC_FRAMING DUMMYLASTMSGTYPE
+#define NUM_TRAFFIC_TYPES (DUMMYLASTMSGTYPE + 1)
+
+enum TrafficOutcome { TRAFFIC_SENT, TRAFFIC_DELIVERED, TRAFFIC_DROP_PROB, TRAFFIC_DROP_SIZE, TRAFFIC_DROP_FULL, NUM_TRAFFIC_OUTCOMES };
+
+/**
+ * Struct Name: TrafficCount
+ */
+typedef struct TrafficCount {
+	long msgs;
+	long bytes;
+}TrafficCount;
+
+/**
+ * Struct Name: en_payload
+ *
+ * Payload of a message, followed by its bytes.  A unicast carries it inline after its
+ * en_msg; a multicast stores it once and every recipient's en_msg references it.  The
+ * receiver's inbox holds a reference from ENrecv until it calls ENrelease.
+ */
+typedef struct en_payload {
+	// Messages and inbox entries still referencing it
+	int refs;
+	// Number of bytes after the struct
+	int size;
+	// Allocation freed with the last reference: the en_msg of a unicast, or the payload
+	void *block;
+}en_payload;
+
 /**
  * Struct Name: en_msg
  */
@@ -27,6 +62,8 @@ typedef struct en_msg {
 	Address from;
 	// Destination node
 	Address to;
+	// Payload, inline after the message or shared with the other recipients
+	en_payload *shared;
 }en_msg;
 
 /**
@@ -80,10 +117,27 @@ class EmulNet
 { 	
 private:
 	Params* par;
-	int sent_msgs[MAX_NODES + 1][MAX_TIME];
-	int recv_msgs[MAX_NODES + 1][MAX_TIME];
+	// Messages sent and received by each node (indexed by id, up to EN_GPSZ) in each
+	// tick; a row only grows to the last tick the node had a message in
+	vector< vector<int> > sent_msgs;
+	vector< vector<int> > recv_msgs;
+	// Per-node traffic, NUM_TRAFFIC_TYPES x NUM_TRAFFIC_OUTCOMES counters for each id
+	vector<TrafficCount> traffic;
+	TrafficCount trafficTotal[NUM_TRAFFIC_TYPES][NUM_TRAFFIC_OUTCOMES];
+	// Sparse (src, dst) traffic matrix, since the start and since the last dump
+	unordered_map<long, TrafficCount> matrix;
+	unordered_map<long, TrafficCount> matrixPeriod;
+	long matrixPeriodStart;
+	FILE *matrixFile;
 	int enInited;
 	EM emulnet;
+	void countLink(int src, int dst, const char *data, int size);
+	void dumpMatrix(unordered_map<long, TrafficCount> &links, const char *what, long from);
+	void addTraffic(int node, int type, int outcome, long msgs, long bytes);
+	void countTraffic(int node, const char *data, int size, int outcome);
+	TrafficCount &trafficAt(int node, int type, int outcome) {
+		return traffic[((long) node * NUM_TRAFFIC_TYPES + type) * NUM_TRAFFIC_OUTCOMES + outcome];
+	}
 public:
  	EmulNet(Params *p);
  	EmulNet(EmulNet &anotherEmulNet);
@@ -92,8 +146,14 @@ public:
 	void *ENinit(Address *myaddr, short port);
 	int ENsend(Address *myaddr, Address *toaddr, string data);
 	int ENsend(Address *myaddr, Address *toaddr, char *data, int size);
+	int ENmulticast(Address *myaddr, Address *toaddrs, int n, char *data, int size);
 	int ENrecv(Address *myaddr, int (* enq)(void *, char *, int), struct timeval *t, int times, void *queue);
+	static void ENrelease(char *data);
 	int ENcleanup();
+	void ENdumpMatrix();
+	TrafficCount ENtraffic(int node, int type, int outcome) { return trafficAt(node, type, outcome); }
+	TrafficCount ENtrafficTotal(int type, int outcome) { return trafficTotal[type][outcome]; }
+	int ENbuffered() { return emulnet.currbuffsize; }
 };
 
 #endif /* _EMULNET_H_ */
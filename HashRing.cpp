@@ -0,0 +1,236 @@
+/**********************************
+ * FILE NAME: HashRing.cpp
+ *
+ * DESCRIPTION: Consistent-hash ring over the membership view.
+ * 				Definition of HashRing class functions.
+ **********************************/
+
+#include "HashRing.h"
+
+/**
+ * Constructor
+ */
+HashRing::HashRing(int vnodes): vnodes(max(1, vnodes)), members(0), changes(0), movedKeys(0) {}
+
+/**
+ * FUNCTION NAME: mix
+ *
+ * DESCRIPTION: murmur3 32-bit finaliser
+ */
+static uint32_t mix(uint32_t h) {
+	h ^= h >> 16;
+	h *= 0x85ebca6bu;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35u;
+	h ^= h >> 16;
+	return h;
+}
+
+/**
+ * FUNCTION NAME: pointHash
+ *
+ * DESCRIPTION: Position of a member's replica-th point on the ring
+ */
+uint32_t HashRing::pointHash(Address *addr, int replica) {
+	uint32_t id = *(uint32_t *)(addr->addr);
+	uint16_t port = *(uint16_t *)(&addr->addr[4]);
+	return mix(mix(id * 0x9e3779b1u ^ port) + (uint32_t) replica * 0x7feb352du);
+}
+
+/**
+ * FUNCTION NAME: keyHash
+ *
+ * DESCRIPTION: Position of a key on the ring (FNV-1a, then mixed)
+ */
+uint32_t HashRing::keyHash(const string &key) {
+	uint32_t h = 2166136261u;
+	for ( size_t i = 0; i < key.size(); i++ ) {
+		h ^= (unsigned char) key[i];
+		h *= 16777619u;
+	}
+	return mix(h);
+}
+
+/**
+ * FUNCTION NAME: before
+ *
+ * DESCRIPTION: Point preceding it on the ring, wrapping around
+ */
+map<uint32_t, Address>::iterator HashRing::before(map<uint32_t, Address>::iterator it) {
+	if ( it == points.begin() ) {
+		it = points.end();
+	}
+	return --it;
+}
+
+/**
+ * FUNCTION NAME: record
+ *
+ * DESCRIPTION: Account for the range (start, end] changing owner.  A null from/to is the
+ *              empty ring.  Ranges handed between two points of the same member are
+ *              intermediate steps of a multi-point change and are not reported.
+ */
+void HashRing::record(uint32_t start, uint32_t end, Address *from, Address *to, vector<RingMove> *moved) {
+	RingMove mv;
+	uint32_t width = end - start;
+
+	if ( from != NULL && to != NULL && *from == *to ) {
+		return;
+	}
+
+	mv.start = start;
+	mv.end = end;
+	mv.from.init();
+	mv.to.init();
+	if ( from != NULL ) {
+		mv.from = *from;
+	}
+	if ( to != NULL ) {
+		mv.to = *to;
+	}
+	// width 0 is the whole ring
+	movedKeys += (width == 0 ? 4294967296.0 : (double) width) / 4294967296.0;
+	if ( moved != NULL ) {
+		moved->push_back(mv);
+	}
+}
+
+/**
+ * FUNCTION NAME: contains
+ *
+ * DESCRIPTION: Whether the member has points on the ring
+ */
+bool HashRing::contains(Address *addr) {
+	map<uint32_t, Address>::iterator it;
+
+	for ( int r = 0; r < vnodes; r++ ) {
+		it = points.find(pointHash(addr, r));
+		if ( it != points.end() && it->second == *addr ) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * FUNCTION NAME: add
+ *
+ * DESCRIPTION: Insert the member's points.  Each point takes over the range between its
+ *              predecessor and itself from the owner of the next point.  A point that
+ *              collides with another member's is skipped.  Returns the points inserted.
+ */
+int HashRing::add(Address *addr, vector<RingMove> *moved) {
+	map<uint32_t, Address>::iterator it, next;
+	int added = 0;
+
+	if ( contains(addr) ) {
+		return 0;
+	}
+
+	for ( int r = 0; r < vnodes; r++ ) {
+		uint32_t h = pointHash(addr, r);
+		if ( points.count(h) ) {
+			continue;
+		}
+		it = points.insert(make_pair(h, *addr)).first;
+		added++;
+		if ( points.size() == 1 ) {
+			record(h, h, NULL, addr, moved);
+			continue;
+		}
+		next = it;
+		if ( ++next == points.end() ) {
+			next = points.begin();
+		}
+		record(before(it)->first, h, &next->second, addr, moved);
+	}
+
+	if ( added > 0 ) {
+		members++;
+		changes++;
+	}
+	return added;
+}
+
+/**
+ * FUNCTION NAME: remove
+ *
+ * DESCRIPTION: Erase the member's points.  The range of each point goes to the owner of
+ *              the next point.  Returns the points erased.
+ */
+int HashRing::remove(Address *addr, vector<RingMove> *moved) {
+	map<uint32_t, Address>::iterator it, next;
+	int removed = 0;
+
+	for ( int r = 0; r < vnodes; r++ ) {
+		uint32_t h = pointHash(addr, r);
+		it = points.find(h);
+		if ( it == points.end() || !(it->second == *addr) ) {
+			continue;
+		}
+		if ( points.size() == 1 ) {
+			record(h, h, addr, NULL, moved);
+		}
+		else {
+			next = it;
+			if ( ++next == points.end() ) {
+				next = points.begin();
+			}
+			record(before(it)->first, h, addr, &next->second, moved);
+		}
+		points.erase(it);
+		removed++;
+	}
+
+	if ( removed > 0 ) {
+		members--;
+		changes++;
+	}
+	return removed;
+}
+
+/**
+ * FUNCTION NAME: owner
+ *
+ * DESCRIPTION: Member owning the key.  Returns false if the ring is empty.
+ */
+bool HashRing::owner(uint32_t key, Address *addr) {
+	map<uint32_t, Address>::iterator it;
+
+	if ( points.empty() ) {
+		return false;
+	}
+	it = points.lower_bound(key);
+	if ( it == points.end() ) {
+		it = points.begin();
+	}
+	*addr = it->second;
+	return true;
+}
+
+/**
+ * FUNCTION NAME: successors
+ *
+ * DESCRIPTION: Up to n distinct members following the key clockwise, owner first (the
+ *              replica set of the key).  Returns the number found.
+ */
+int HashRing::successors(uint32_t key, int n, vector<Address> &out) {
+	map<uint32_t, Address>::iterator it;
+	size_t steps;
+
+	out.clear();
+	if ( points.empty() || n <= 0 ) {
+		return 0;
+	}
+	it = points.lower_bound(key);
+	for ( steps = 0; steps < points.size() && (int) out.size() < min(n, members); steps++ ) {
+		if ( it == points.end() ) {
+			it = points.begin();
+		}
+		if ( find(out.begin(), out.end(), it->second) == out.end() ) {
+			out.push_back(it->second);
+		}
+		++it;
+	}
+	return (int) out.size();
+}
@@ -0,0 +1,63 @@
+/**********************************
+ * FILE NAME: HashRing.h
+ *
+ * DESCRIPTION: Consistent-hash ring over the membership view.
+ * 				Header file of HashRing class.
+ **********************************/
+
+#ifndef _HASHRING_H_
+#define _HASHRING_H_
+
+#include "stdincludes.h"
+#include "Member.h"
+
+/**
+ * STRUCT NAME: RingMove
+ *
+ * DESCRIPTION: Key range (start, end] of the ring that changed owner.  start > end means
+ *              the range wraps around zero; start == end means the whole ring.
+ */
+typedef struct RingMove {
+	uint32_t start;
+	uint32_t end;
+	Address from;
+	Address to;
+} RingMove;
+
+/**
+ * CLASS NAME: HashRing
+ *
+ * DESCRIPTION: Every member owns vnodes points on a 32-bit ring, and a key belongs to the
+ *              member owning the first point at or after its hash.  The points are kept in
+ *              an ordered map, so a join or failure inserts or erases only that member's
+ *              points and lookups are a single O(log n) search.  add() and remove() report
+ *              the key ranges that moved, point by point, with each range going to or
+ *              coming from the neighbouring point's owner.
+ */
+class HashRing {
+private:
+	int vnodes;
+	int members;
+	map<uint32_t, Address> points;
+	// Totals over every change, for reporting
+	long changes;
+	double movedKeys;
+	static uint32_t pointHash(Address *addr, int replica);
+	map<uint32_t, Address>::iterator before(map<uint32_t, Address>::iterator it);
+	void record(uint32_t start, uint32_t end, Address *from, Address *to, vector<RingMove> *moved);
+public:
+	HashRing(int vnodes);
+	virtual ~HashRing() {}
+	static uint32_t keyHash(const string &key);
+	bool contains(Address *addr);
+	int add(Address *addr, vector<RingMove> *moved);
+	int remove(Address *addr, vector<RingMove> *moved);
+	bool owner(uint32_t key, Address *addr);
+	int successors(uint32_t key, int n, vector<Address> &out);
+	int size() { return members; }
+	int pointCount() { return (int) points.size(); }
+	long getChanges() { return changes; }
+	double getMovedKeys() { return movedKeys; }
+};
+
+#endif /* _HASHRING_H_ */
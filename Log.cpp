@@ -12,6 +12,7 @@
 Log::Log(Params *p) {
 	par = p;
 	firstTime = false;
+	prof = NULL;
 }
 
 /**
@@ -20,6 +21,7 @@ Log::Log(Params *p) {
 Log::Log(const Log &anotherLog) {
 	this->par = anotherLog.par;
 	this->firstTime = anotherLog.firstTime;
+	this->prof = anotherLog.prof;
 }
 
 /**
@@ -28,6 +30,7 @@ Log::Log(const Log &anotherLog) {
 Log& Log::operator = (const Log& anotherLog) {
 	this->par = anotherLog.par;
 	this->firstTime = anotherLog.firstTime;
+	this->prof = anotherLog.prof;
 	return *this;
 }
 
@@ -53,6 +56,10 @@ void Log::LOG(Address *addr, const char * str, ...) {
 	static char stdstring3[40]; 
 	static int dbg_opened=0;
 
+	if ( prof ) {
+		prof->enter(PROF_LOG);
+	}
+
 	if(dbg_opened != 639){
 		numwrites=0;
 
@@ -106,6 +113,9 @@ void Log::LOG(Address *addr, const char * str, ...) {
 		numwrites=0;
 	}
 
+	if ( prof ) {
+		prof->leave();
+	}
 }
 
 /**
@@ -10,6 +10,7 @@
 #include "stdincludes.h"
 #include "Params.h"
 #include "Member.h"
+#include "TickProfiler.h"
 
 /*
  * Macros
@@ -29,6 +30,7 @@ class Log{
 private:
 	Params *par;
 	bool firstTime;
+	TickProfiler *prof;
 public:
 	Log(Params *p);
 	Log(const Log &anotherLog);
@@ -37,6 +39,7 @@ public:
 	void LOG(Address *, const char * str, ...);
 	void logNodeAdd(Address *, Address *);
 	void logNodeRemove(Address *, Address *);
+	void setProfiler(TickProfiler *p) { prof = p; }
 };
 
 #endif /* _LOG_H_ */
@@ -7,6 +7,24 @@
 
 #include "MP1Node.h"
 
+/**
+ * FUNCTION NAME: memberLess
+ *
+ * DESCRIPTION: Order of the membership list: by id, then port
+ */
+static bool memberLess(const MemberListEntry &a, const MemberListEntry &b) {
+    return a.id < b.id || (a.id == b.id && a.port < b.port);
+}
+
+/**
+ * FUNCTION NAME: addressKey
+ *
+ * DESCRIPTION: Address packed into a map key: id, then port
+ */
+static long addressKey(Address *addr) {
+    return ((long) *(int *)(addr->addr) << 16) | (unsigned short) *(short *)(&addr->addr[4]);
+}
+
 /*
  * Note: You can change/add any functions in MP1Node.{h,cpp}
  */
@@ -33,12 +51,53 @@ MP1Node::MP1Node(Member *member, Params *params, EmulNet *emul, Log *log, Addres
     memcpy((char *) &this->failedList4.addr, this->NULLADDR, sizeof(char[6]));
     memcpy((char *) this->pingList.addr, this->NULLADDR, sizeof(char[6]));
     this->cntfailed = 0;
+    this->localHealth = 0;
+    this->pingSentAt = 0;
+    this->refutedAt = -1;
+    this->phiDetector = new PhiAccrual(par->PHI_WINDOW, par->PHI_MIN_STDDEV > 0 ? par->PHI_MIN_STDDEV : 2 * TIMEOUT, TIMEOUT);
+    this->joinStartTime = -1;
+    this->fullViewTime = -1;
+    this->joinViewTarget = 0;
+    this->view = new PartialView(par->ACTIVE_VIEW_SIZE, par->PASSIVE_VIEW_SIZE);
+    this->shuffleCounter = par->SHUFFLE_PERIOD;
+    memcpy((char *) this->neighborPending.addr, this->NULLADDR, sizeof(char[6]));
+    this->neighborPendingUntil = 0;
+    this->recvThisTick = 0;
+    this->joinReqsThisTick = 0;
+    this->totalRecv = 0;
+    this->peakRecv = 0;
+    this->peakJoinReqs = 0;
+    this->activeTicks = 0;
+    this->joinReqsHandled = 0;
+    this->joinReqsForwarded = 0;
+    this->joinTime = -1;
+    this->joinAttempts = 0;
+    this->joinRetryAt = 0;
+    this->digest = new ViewDigest(par->DIGEST_BUCKETS, par->EN_GPSZ);
+    this->antiEntropyCounter = par->ANTI_ENTROPY_PERIOD;
+    this->nextSubscription = 1;
+    this->viewVersion = 0;
+    this->protocol = Protocol::create(par);
+    this->bytesSent = 0;
+    this->packetsSent = 0;
+    this->prof = NULL;
+    this->tracer = NULL;
+    this->pingTrace = 0;
+    this->probesStarted = 0;
+    this->probesAcked = 0;
+    this->probesIndirect = 0;
+    this->probesTimedOut = 0;
 }
 
 /**
  * Destructor of the MP1Node class
  */
-MP1Node::~MP1Node() {}
+MP1Node::~MP1Node() {
+    delete this->phiDetector;
+    delete this->view;
+    delete this->digest;
+    delete this->protocol;
+}
 
 /**
  * FUNCTION NAME: recvLoop
@@ -91,6 +150,7 @@ void MP1Node::nodeStart(char *servaddrstr, short servport) {
 #endif
         exit(1);
     }
+    flushMessages();
 
     return;
 }
@@ -126,8 +186,6 @@ int MP1Node::initThisNode(Address *joinaddr) {
  * DESCRIPTION: Join the distributed system
  */
 int MP1Node::introduceSelfToGroup(Address *joinaddr) {
-	MessageHdr *msg;
-    char *ptr;
     MemberListEntry *mle;
     
 #ifdef DEBUGLOG
@@ -146,17 +204,6 @@ int MP1Node::introduceSelfToGroup(Address *joinaddr) {
         free(mle);
     }
     else {
-        size_t msgsize = sizeof(MessageHdr) + sizeof(joinaddr->addr) + sizeof(long) + 1;
-        msg = (MessageHdr *) malloc(msgsize * sizeof(char));
-
-        // create JOINREQ message: format of data is {struct Address myaddr}
-        /*
-        msg->msgType = JOINREQ;
-        memcpy((char *)(msg+1), &memberNode->addr.addr, sizeof(memberNode->addr.addr));
-        memcpy((char *)(msg+1) + 1 + sizeof(memberNode->addr.addr), &memberNode->heartbeat, sizeof(long));
-         */
-        
-        createMessageHdr(msg, JOINREQ, &memberNode->addr, memberNode->heartbeat, &ptr);
         cout<<"Sending JOINREQ: "<< memberNode->addr.addr <<" heartbeat: " << memberNode->heartbeat << endl;
 
 #ifdef DEBUGLOG
@@ -164,10 +211,11 @@ int MP1Node::introduceSelfToGroup(Address *joinaddr) {
         log->LOG(&memberNode->addr, s);
 #endif
 
-        // send JOINREQ message to introducer member
-        emulNet->ENsend(&memberNode->addr, joinaddr, (char *)msg, msgsize);
-
-        free(msg);
+        // send JOINREQ message to a seed member; retryJoin() resends it until a JOINREP arrives
+        sendJOINREQ(joinaddr, NULL, 0);
+        this->joinStartTime = par->getcurrtime();
+        this->joinAttempts = 1;
+        this->joinRetryAt = this->joinStartTime + par->JOIN_RETRY_BASE;
     }
 
     return 1;
@@ -177,12 +225,29 @@ int MP1Node::introduceSelfToGroup(Address *joinaddr) {
 /**
  * FUNCTION NAME: finishUpThisNode
  *
- * DESCRIPTION: Wind up this node and clean up state
+ * DESCRIPTION: Wind up this node and clean up state.  A member of the group leaves it on
+ *              purpose: LEAVE goes to LEAVE_FANOUT random peers of my list, who drop me at
+ *              once and piggyback the departure on their pings, so nobody has to detect
+ *              me as failed.
  */
 int MP1Node::finishUpThisNode(){
-   /*
-    * Your code goes here
-    */
+    vector<Address> peers;
+    int i, j;
+    
+    if (memberNode->inGroup && not memberNode->bFailed) {
+        getPeers(peers);
+        for (i = 0; i < par->LEAVE_FANOUT && i < (int) peers.size(); i++) {
+            j = i + rand() % (peers.size() - i);
+            swap(peers[i], peers[j]);
+        }
+        sendLEAVE(peers.data(), i);
+        flushMessages();
+#ifdef DEBUGLOG
+        log->LOG(&memberNode->addr, "Leaving the group...");
+#endif
+    }
+    memberNode->inGroup = false;
+    
     return 1;
 }
 
@@ -197,22 +262,174 @@ void MP1Node::nodeLoop() {
     	return;
     }
 
-    memberNode->heartbeat++;
+    bumpHeartbeat();
+    this->recvThisTick = 0;
+    this->joinReqsThisTick = 0;
     
     // Check my messages
+    if (prof) {
+        prof->enter(PROF_MESSAGES);
+    }
     checkMessages();
+    checkFullView();
+    if (prof) {
+        prof->leave();
+    }
+    this->activeTicks++;
+    this->totalRecv += this->recvThisTick;
+    this->peakRecv = max(this->peakRecv, this->recvThisTick);
+    this->peakJoinReqs = max(this->peakJoinReqs, this->joinReqsThisTick);
 
     // Wait until you're in the group...
-    if( !memberNode->inGroup ) {
-    	return;
+    if (prof) {
+        prof->enter(PROF_OPS);
+    }
+    if( memberNode->inGroup ) {
+        // ...then jump in and share your responsibilites!
+        nodeLoopOps();
+    }
+    if (not joinComplete()) {
+        retryJoin();
+    }
+    if (prof) {
+        prof->leave();
     }
 
-    // ...then jump in and share your responsibilites!
-    nodeLoopOps();
+    // Send everything queued during this tick, one frame per destination
+    if (prof) {
+        prof->enter(PROF_FLUSH);
+    }
+    flushMessages();
+    publishEvents();
+    if (prof) {
+        prof->leave();
+    }
 
     return;
 }
 
+/**
+ * FUNCTION NAME: retryJoin
+ *
+ * DESCRIPTION: Resend the JOINREQ, to a freshly picked seed, until joinComplete().  The
+ *              wait doubles after every attempt up to JOIN_RETRY_MAX and is jittered over
+ *              its upper half so that nodes that lost their requests together do not all
+ *              retry in the same tick.
+ */
+void MP1Node::retryJoin() {
+    Address joinaddr;
+    long backoff;
+    
+    if (this->joinStartTime < 0 || par->getcurrtime() < this->joinRetryAt) {
+        return;
+    }
+    
+    joinaddr = getJoinAddress();
+#ifdef DEBUGLOG
+    log->LOG(&memberNode->addr, "Retrying join (attempt %d)...", this->joinAttempts + 1);
+#endif
+    sendJOINREQ(&joinaddr, NULL, 0);
+    
+    backoff = min((long) par->JOIN_RETRY_MAX, (long) par->JOIN_RETRY_BASE << min(this->joinAttempts, 16));
+    this->joinAttempts++;
+    this->joinRetryAt = par->getcurrtime() + backoff - rand() % (backoff / 2 + 1);
+}
+
+/**
+ * FUNCTION NAME: joinComplete
+ *
+ * DESCRIPTION: True once a JOINREP has arrived and my view is complete: my list has
+ *              reached the size the introducer reported, or every JOINREP fragment is in
+ */
+bool MP1Node::joinComplete() {
+    if (not memberNode->inGroup) {
+        return false;
+    }
+    if (this->fullViewTime >= 0) {
+        return true;
+    }
+    for (int i = 0; i < (int) this->joinFragments.size(); i++) {
+        if (not this->joinFragments[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * FUNCTION NAME: subscribe
+ *
+ * DESCRIPTION: Register a callback for membership changes.  It is called at the end of
+ *              every tick that changed my list, with all of that tick's events in order.
+ *
+ * RETURNS:
+ * subscription id for unsubscribe()
+ */
+int MP1Node::subscribe(MembershipCallback callback, void *env) {
+    Subscription sub;
+    
+    sub.id = this->nextSubscription++;
+    sub.callback = callback;
+    sub.env = env;
+    this->subscribers.push_back(sub);
+    return sub.id;
+}
+
+/**
+ * FUNCTION NAME: unsubscribe
+ *
+ * DESCRIPTION: Stop delivering events to a subscriber
+ */
+void MP1Node::unsubscribe(int id) {
+    for (int i = 0; i < (int) this->subscribers.size(); i++) {
+        if (this->subscribers[i].id == id) {
+            this->subscribers.erase(this->subscribers.begin() + i);
+            return;
+        }
+    }
+}
+
+/**
+ * FUNCTION NAME: raiseEvent
+ *
+ * DESCRIPTION: Queue a membership event for this tick's batch
+ */
+void MP1Node::raiseEvent(int type, Address *addr) {
+    MembershipEvent ev;
+    
+    ev.type = type;
+    ev.addr = *addr;
+    ev.time = par->getcurrtime();
+    this->pendingEvents.push_back(ev);
+}
+
+/**
+ * FUNCTION NAME: publishEvents
+ *
+ * DESCRIPTION: Deliver this tick's events as one batch.  The view version goes up by one
+ *              for every batch, so subscribers can tell whether they missed one.  While
+ *              a snapshot reader is registered, each version is also published as a
+ *              snapshot of my list; a reader that registers later gets the current
+ *              version at the next tick.
+ */
+void MP1Node::publishEvents() {
+    this->snapshots.reclaim();
+    if (not this->pendingEvents.empty()) {
+        this->viewVersion++;
+    }
+    if (this->snapshots.hasReaders() && this->snapshots.currentVersion() != this->viewVersion) {
+        this->snapshots.publish(new ViewSnapshot(this->viewVersion, par->getcurrtime(), memberNode->memberList));
+    }
+    if (this->pendingEvents.empty()) {
+        return;
+    }
+    
+    for (int i = 0; i < (int) this->subscribers.size(); i++) {
+        this->subscribers[i].callback(this->subscribers[i].env, this->viewVersion, this->pendingEvents);
+    }
+    this->pendingEvents.clear();
+}
+
 /**
  * FUNCTION NAME: checkMessages
  *
@@ -228,6 +445,7 @@ void MP1Node::checkMessages() {
     	size = memberNode->mp1q.front().size;
     	memberNode->mp1q.pop();
     	recvCallBack((void *)memberNode, (char *)ptr, size);
+    	EmulNet::ENrelease((char *)ptr);
     }
     return;
 }
@@ -235,128 +453,138 @@ void MP1Node::checkMessages() {
 /**
  * FUNCTION NAME: recvCallBack
  *
- * DESCRIPTION: Message handler for different message types
+ * DESCRIPTION: Unpack a received frame and handle each message it carries
  */
 bool MP1Node::recvCallBack(void *env, char *data, int size ) {
-	/*
-	 * Your code goes here
-	 */
-    MessageHdr msgHdr;
+    FrameReader frame;
+    const char *msgdata;
+    int msgsize;
+    bool ok = true;
+    
+    frame.open(data, size);
+    while (frame.next(&msgdata, &msgsize)) {
+        // Time each message under its type (second byte of the header)
+        if (prof) {
+            prof->enter(PROF_MSG + ((msgsize >= 2 && (unsigned char)msgdata[1] < DUMMYLASTMSGTYPE) ? (unsigned char)msgdata[1] : DUMMYLASTMSGTYPE));
+        }
+        MP1_PROBE3(msg_dispatch, *(int *)(memberNode->addr.addr), msgsize > 1 ? (int)(unsigned char)msgdata[1] : -1, msgsize);
+        ok = handleMessage(msgdata, msgsize) && ok;
+        if (prof) {
+            prof->leave();
+        }
+    }
+    
+    return ok;
+}
+
+/**
+ * FUNCTION NAME: handleMessage
+ *
+ * DESCRIPTION: Message handler for different message types
+ */
+bool MP1Node::handleMessage(const char *data, int size) {
+    MsgView msg;
     Address peeraddr;
     Address pingaddr;
     Address fromaddr;
-    Address failedaddr;
     long heartbeat;
-    MemberListEntry *mle;
-    int membercnt = 0;
-    char *ptr;
+    unsigned long trace;
+    MemberListEntry mle;
+    
+    if (not msg.parse(data, size)) {
+#ifdef DEBUGLOG
+        log->LOG(&memberNode->addr, "Dropping malformed message of %d bytes", size);
+#endif
+        return false;
+    }
     
-    getSenderInfo(data, &msgHdr, &peeraddr, &heartbeat, &ptr);
-    mle = (MemberListEntry *) malloc(sizeof(MemberListEntry));
-    cout << "memberNode address: " << memberNode->addr.getAddress() << " Curr Time: " << this->par->getcurrtime() << endl;
-    cout << "memberNode pingcounter: " << memberNode->pingCounter << " Timeoutcounter: " << memberNode->timeOutCounter << endl;
+    peeraddr = msg.getFrom();
+    heartbeat = msg.getHeartbeat();
+    trace = msg.getUint(FIELD_trace);
+    this->recvThisTick++;
+    if (tracer && trace) {
+        tracer->received(trace, *(int *)(memberNode->addr.addr), *(int *)(peeraddr.addr), msg.getType());
+    }
+    if (memberNode->inGroup && protocol->handle(this, &msg)) {
+        return true;
+    }
+    notePeerAlive(&peeraddr);
+    if (msg.getType() <= FAILED) {
+        // Only the original message types are echoed; the overlay, digest and departure
+        // traffic would flood stdout in large groups
+        cout << "memberNode address: " << memberNode->addr.getAddress() << " Curr Time: " << this->par->getcurrtime() << endl;
+        cout << "memberNode pingcounter: " << memberNode->pingCounter << " Timeoutcounter: " << memberNode->timeOutCounter << endl;
+    }
     
-    if (msgHdr.msgType == JOINREQ) {
+    if (msg.getType() == JOINREQ) {
         cout<<"JOINREQ: "<<peeraddr.getAddress() <<" heartbeat: " << heartbeat << endl;
-        updateMLEFromValues(mle, &peeraddr, &heartbeat, &memberNode->heartbeat);
-        addMember(mle);
-        sendJOINREP(&peeraddr, memberNode->memberList);
-        //sendJOINREP(&peeraddr);
+        handleJoinRequest(&msg);
         
-    } else if (msgHdr.msgType == JOINREP) {
+    } else if (msg.getType() == JOINREP) {
         cout<<"JOINREP: "<<peeraddr.getAddress()  <<" heartbeat: " << heartbeat << endl;
+        if (not memberNode->inGroup) {
 #ifdef DEBUGLOG
-        log->LOG(&memberNode->addr, "Joining a group...");
+            log->LOG(&memberNode->addr, "Joining a group...");
 #endif
+            this->joinTime = par->getcurrtime();
+        }
         memberNode->inGroup = true;
+        if (par->VIEW_MODE == PARTIAL_VIEW) {
+            addNeighbor(&peeraddr, heartbeat);
+        }
+        mergeMembers(&msg);
         
-        // The MemberListEntry items are appended to the end of the message.
-        // Work out how many there are.
-        membercnt = (size -
-                     sizeof(int) - sizeof(peeraddr.addr) - sizeof(long) - 1)/
-                    (sizeof(int)+sizeof(short)+sizeof(long));
-        
-        for (int i = 0; i < membercnt; i++) {
-            mle->setid((int) *ptr);
-            ptr += sizeof(int);
-            mle->setport((short) *ptr);
-            ptr += sizeof(short);
-            mle->setheartbeat((long) *ptr);
-            ptr += sizeof(long);
-            mle->settimestamp(memberNode->heartbeat);
-            addMember(mle);
+        // Fragments may arrive in any order; each is merged as it comes in
+        if (msg.getUint(FIELD_fragments) > 0 && msg.getUint(FIELD_fragment) < msg.getUint(FIELD_fragments)) {
+            if (this->joinFragments.size() != msg.getUint(FIELD_fragments)) {
+                this->joinFragments.assign(msg.getUint(FIELD_fragments), false);
+            }
+            this->joinFragments[msg.getUint(FIELD_fragment)] = true;
         }
-    } else if (msgHdr.msgType == PING) {
+        this->joinViewTarget = max(this->joinViewTarget, (int) msg.getUint(FIELD_total));
+    } else if (msg.getType() == PING) {
         cout<<"PING: "<<peeraddr.getAddress()  <<" heartbeat: " << heartbeat << endl;
 #ifdef DEBUGLOG
         log->LOG(&memberNode->addr, "Received a ping...");
 #endif
         
-        updateMLEFromValues(mle, &peeraddr, &heartbeat, &memberNode->heartbeat);
-        addMember(mle);
-        
-        // The next value is an integer stating the size of the membership list
-        membercnt = (int)*ptr;
-        ptr += sizeof(int);
-        
-        for (int i = 0; i < membercnt; i++) {
-            mle->setid((int) *ptr);
-            ptr += sizeof(int);
-            mle->setport((short) *ptr);
-            ptr += sizeof(short);
-            mle->setheartbeat((long) *ptr);
-            ptr += sizeof(long);
-            mle->settimestamp(memberNode->heartbeat);
-            addMember(mle);
-        }
-        
-        for (int i =0; i < 5; i++) {
-            // There is information about four failed member attached.
-            memcpy(failedaddr.addr, ptr, sizeof(char[6]));
-            removeMember(&failedaddr);
-            addFailed(&failedaddr);
-            ptr += sizeof(char[6]);
-        }
+        updateMLEFromValues(&mle, &peeraddr, &heartbeat, &memberNode->heartbeat);
+        addMember(&mle);
+        mergeMembers(&msg);
+        processFailed(&msg);
+        processLeft(&msg);
         
-        sendPINGREP(&peeraddr);
-    } else if (msgHdr.msgType == PINGREP) {
+        sendPINGREP(&peeraddr, trace);
+    } else if (msg.getType() == PINGREP) {
         cout<<"PINGREP: "<<peeraddr.getAddress()  <<" heartbeat: " << heartbeat << endl;
 #ifdef DEBUGLOG
         log->LOG(&memberNode->addr, "Received a ping response...");
 #endif
         
-        updateMLEFromValues(mle, &peeraddr, &heartbeat, &memberNode->heartbeat);
-        addMember(mle);
-        
-        for (int i =0; i < 5; i++) {
-            // There is information about four failed member attached.
-            memcpy(failedaddr.addr, ptr, sizeof(char[6]));
-            removeMember(&failedaddr);
-            addFailed(&failedaddr);
-            ptr += sizeof(char[6]);
-        }
+        updateMLEFromValues(&mle, &peeraddr, &heartbeat, &memberNode->heartbeat);
+        addMember(&mle);
+        processFailed(&msg);
+        processLeft(&msg);
         
-        if (*(int *) this->pingList.addr == *(int *)peeraddr.addr &&
-            *(short *) &this->pingList.addr[4] == *(short *) &peeraddr.addr[4]) {
+        if (isSameAddress(&this->pingList, &peeraddr)) {
             // This is the response to my ping
-            eraseFromPingList();
+            updatePeerRtt(&peeraddr, par->getcurrtime() - this->pingSentAt);
+            updateLocalHealth(-1);
+            this->probesAcked++;
+            eraseFromPingList("ack");
         }
-    } else if (msgHdr.msgType == INDPING) {
+    } else if (msg.getType() == INDPING) {
         cout<<"INDPING: "<<peeraddr.getAddress()  <<" heartbeat: " << heartbeat << endl;
 #ifdef DEBUGLOG
         log->LOG(&memberNode->addr, "Received an indping ...");
 #endif
-        // Get ping address
-        memcpy(&pingaddr.addr, (char *) ptr, sizeof(peeraddr.addr));
-        ptr += sizeof(pingaddr.addr);
-        // Get from address
-        memcpy(&fromaddr.addr, (char *) ptr, sizeof(peeraddr.addr));
-        ptr += sizeof(fromaddr.addr);
+        pingaddr = msg.getAddr(FIELD_target);
+        fromaddr = msg.getAddr(FIELD_origin);
         
         if (isSameAddress(&memberNode->addr, &pingaddr)) {
             cout<<"INDPING RESPONDING FROM: "<<memberNode->addr.getAddress()  << endl;
             // I'm being indirectly pinged so respond with an INDPING response
-            sendINDPINGREP(&peeraddr, &pingaddr, &fromaddr, &this->failedList);
+            sendINDPINGREP(&peeraddr, &pingaddr, &fromaddr, &this->failedList, trace);
         } else {
             // I'm being asked to forward an INDPING so include the origin peer in the message
             // and the current failed peer.
@@ -364,38 +592,31 @@ bool MP1Node::recvCallBack(void *env, char *data, int size ) {
 #ifdef DEBUGLOG
             log->LOG(&memberNode->addr, "Forward an indping ...");
 #endif
-            sendINDPING(&pingaddr, &pingaddr, &fromaddr, &this->failedList);
+            sendINDPING(&pingaddr, &pingaddr, &fromaddr, &this->failedList, trace);
             
         }
-        updateMLEFromValues(mle, &peeraddr, &heartbeat, &memberNode->heartbeat);
-        addMember(mle);
-        for (int i =0; i < 5; i++) {
-            // There is information about four failed member attached.
-            memcpy(failedaddr.addr, ptr, sizeof(char[6]));
-            removeMember(&failedaddr);
-            addFailed(&failedaddr);
-            ptr += sizeof(char[6]);
-        }
-    } else if (msgHdr.msgType == INDPINGREP) {
+        updateMLEFromValues(&mle, &peeraddr, &heartbeat, &memberNode->heartbeat);
+        addMember(&mle);
+        processFailed(&msg);
+    } else if (msg.getType() == INDPINGREP) {
         cout<<"INDPING: "<<peeraddr.getAddress()  <<" heartbeat: " << heartbeat << endl;
 #ifdef DEBUGLOG
         log->LOG(&memberNode->addr, "Received an indping ...");
 #endif
-        // Get ping address
-        memcpy(&pingaddr.addr, (char *) ptr, sizeof(peeraddr.addr));
-        ptr += sizeof(pingaddr.addr);
-        // Get from address
-        memcpy(&fromaddr.addr, (char *) ptr, sizeof(peeraddr.addr));
-        ptr += sizeof(fromaddr.addr);
+        pingaddr = msg.getAddr(FIELD_target);
+        fromaddr = msg.getAddr(FIELD_origin);
         
         if (isSameAddress(&memberNode->addr, &fromaddr)) {
             cout<<"INDPINGREP received FOR: "<<memberNode->addr.getAddress()  << endl;
             // I've received the INDPINGREP
-            // If the ping entry matches, then remove it
-            if (*(int *) this->pingList.addr == *(int *)pingaddr.addr &&
-                *(short *) &this->pingList.addr[4] == *(short *) &pingaddr.addr[4]) {
+            // If the ping entry matches, then remove it.  Replies relayed by the other
+            // indirect probes arrive after this and no longer match.
+            notePeerAlive(&pingaddr);
+            if (isSameAddress(&this->pingList, &pingaddr)) {
                 // This is the response to my ping
-                eraseFromPingList();
+                updateLocalHealth(-1);
+                this->probesIndirect++;
+                eraseFromPingList("indirect ack");
             }
         } else {
             // I'm being asked to forward an INDPINGREP so include the origin peer in the message
@@ -404,386 +625,1403 @@ bool MP1Node::recvCallBack(void *env, char *data, int size ) {
 #ifdef DEBUGLOG
             log->LOG(&memberNode->addr, "Forward an indping response ...");
 #endif
-            sendINDPINGREP(&fromaddr, &pingaddr, &fromaddr, &this->failedList);
+            sendINDPINGREP(&fromaddr, &pingaddr, &fromaddr, &this->failedList, trace);
         }
-        updateMLEFromValues(mle, &peeraddr, &heartbeat, &memberNode->heartbeat);
-        addMember(mle);
-        for (int i =0; i < 5; i++) {
-            // There is information about four failed member attached.
-            memcpy(failedaddr.addr, ptr, sizeof(char[6]));
-            removeMember(&failedaddr);
-            addFailed(&failedaddr);
-            ptr += sizeof(char[6]);
+        updateMLEFromValues(&mle, &peeraddr, &heartbeat, &memberNode->heartbeat);
+        addMember(&mle);
+        processFailed(&msg);
+    } else if (msg.getType() == FORWARDJOIN) {
+        handleForwardJoin(&msg);
+    } else if (msg.getType() == NEIGHBOR) {
+        // Always accept a high priority request (the sender has no neighbours left, or a
+        // join walk ended at the sender); otherwise only if I have room
+        if (msg.getUint(FIELD_priority) || not view->activeFull() || view->isActive(&peeraddr)) {
+            addNeighbor(&peeraddr, heartbeat);
+            sendNEIGHBORREP(&peeraddr, true);
+        } else {
+            sendNEIGHBORREP(&peeraddr, false);
+        }
+    } else if (msg.getType() == NEIGHBORREP) {
+        if (isSameAddress(&this->neighborPending, &peeraddr)) {
+            memcpy((char *) this->neighborPending.addr, this->NULLADDR, sizeof(char[6]));
+            this->neighborPendingUntil = 0;
         }
+        if (msg.getUint(FIELD_accept)) {
+            addNeighbor(&peeraddr, heartbeat);
+        }
+    } else if (msg.getType() == DISCONNECT) {
+        if (view->isActive(&peeraddr)) {
+            dropNeighbor(&peeraddr);
+            view->addPassive(&peeraddr);
+        }
+    } else if (msg.getType() == SHUFFLE) {
+        handleShuffle(&msg);
+    } else if (msg.getType() == SHUFFLEREP) {
+        integrateShuffle(&msg);
+    } else if (msg.getType() == DIGEST) {
+        handleDigest(&msg);
+    } else if (msg.getType() == DIGESTREP) {
+        handleDigestRep(&msg);
+    } else if (msg.getType() == DIGESTPUSH) {
+        mergeMembers(&msg);
+    } else if (msg.getType() == LEAVE) {
+        memberLeft(&peeraddr);
     }
         
-    free(mle);
     return true;
     
 }
 
 /**
- * FUNCTION NAME: nodeLoopOps
+ * FUNCTION NAME: handleJoinRequest
  *
- * DESCRIPTION: Check if any node hasn't responded within a timeout period and then delete
- * 				the nodes
- * 				Propagate your membership list
+ * DESCRIPTION: Admit a joining peer.  A request relayed by another member names the
+ *              joiner in its origin field and carries the relay hops left.  A seed that is
+ *              not in the group yet relays the request to the first seed; a member that has
+ *              already handled JOIN_FORWARD_LOAD requests this tick relays it to a random
+ *              member instead, at most JOIN_RELAY_HOPS times per request.
  */
-void MP1Node::nodeLoopOps() {
-    int toind;
+void MP1Node::handleJoinRequest(MsgView *msg) {
+    Address joinaddr = msg->getAddr(FIELD_origin);
     Address toaddr;
-
-    if (memberNode->timeOutCounter > 0)  {
-        memberNode->timeOutCounter--;
-        
-        if (memberNode->pingCounter > 0) {
-            memberNode->pingCounter--;
-            
-            if (memberNode->pingCounter == 0){
-                if (not isNullAddress(&this->pingList)) {
-                    // No response from ping
-                    if (memberNode->memberList.size() > 2){
-                        // There is another peer (other than me and the pingee) in the group that we can try...
-                        toind = rand() % memberNode->memberList.size();
-                        while (memberNode->memberList[toind].getid() == *(int *)(memberNode->addr.addr) ||
-                               memberNode->memberList[toind].getid() == *(int *)(this->pingList.addr)) {
-                            toind = rand() % memberNode->memberList.size();
-                        }
-                        *(int *)(&toaddr.addr)= (int) memberNode->memberList[toind].getid() ;
-                        *(short *)(&toaddr.addr[4]) = (short) memberNode->memberList[toind].getport();
-                        sendINDPING(&toaddr, &this->pingList, &memberNode->addr, &this->failedList);
-                    }
-                }
-            }
+    MemberListEntry mle;
+    long heartbeat = 0;
+    int hops = (int) msg->getUint(FIELD_ttl);
+    
+    if (isNullAddress(&joinaddr)) {
+        joinaddr = msg->getFrom();
+        heartbeat = msg->getHeartbeat();
+        hops = JOIN_RELAY_HOPS;
+    }
+    // A peer that left may come back
+    this->departed.erase(addressKey(&joinaddr));
+    
+    if (not memberNode->inGroup) {
+        toaddr.init();
+        *(int *)(&toaddr.addr) = par->SEEDS[0];
+        if (not isSameAddress(&toaddr, &memberNode->addr) && not isSameAddress(&toaddr, &joinaddr)) {
+            sendJOINREQ(&toaddr, &joinaddr, hops);
         }
-        
+        return;
     }
     
-    if (memberNode->timeOutCounter <= 0) {
-        memberNode->timeOutCounter = TIMEOUT;
-        memberNode->pingCounter = TFAIL;
-        
-        // Check for outstanding pings
-        // If outstanding ping
-        //      - delete the member from the member table
-        //      - add member to Failed list
-        
-        if (not isNullAddress(&this->pingList)){
-            addFailed(&this->pingList);
-            removeMember(&this->pingList);
-            eraseFromPingList();
-        }
+    if (hops > 0 && par->JOIN_FORWARD_LOAD > 0 && this->joinReqsThisTick >= par->JOIN_FORWARD_LOAD &&
+        randomMember(&toaddr, &joinaddr)) {
+#ifdef DEBUGLOG
+        log->LOG(&memberNode->addr, "Forwarding join request...");
+#endif
+        this->joinReqsForwarded++;
+        sendJOINREQ(&toaddr, &joinaddr, hops - 1);
+        return;
+    }
+    
+    this->joinReqsThisTick++;
+    this->joinReqsHandled++;
+    
+    // A retransmitted request (its JOINREP was lost or is still on the way) is answered
+    // again but changes nothing: the joiner is already in my list, so no new entry is
+    // logged and, in partial-view mode, no further join walks are started
+    if (par->VIEW_MODE == PARTIAL_VIEW) {
+        // Take the joiner as a neighbour, hand it just the two of us and let random
+        // walks from my other neighbours find it the rest of its active view
+        vector<MemberListEntry> part;
+        vector<Address> others;
+        bool known = view->isActive(&joinaddr);
         
-        //      - send out ping to random
-        //      - add ping to ping table
-        if (memberNode->memberList.size() > 1){
-            // There is another peer (other than me) in the group that we can ping...
-            toind = rand() % memberNode->memberList.size();
-            while (memberNode->memberList[toind].getid() == *(int *)(memberNode->addr.addr)) {
-                toind = rand() % memberNode->memberList.size();
+        addNeighbor(&joinaddr, heartbeat);
+        for (int i = 0; i < (int) memberNode->memberList.size(); i++) {
+            *(int *)(&toaddr.addr) = memberNode->memberList[i].getid();
+            *(short *)(&toaddr.addr[4]) = memberNode->memberList[i].getport();
+            if (isSameAddress(&toaddr, &joinaddr) || isSameAddress(&toaddr, &memberNode->addr)) {
+                part.push_back(memberNode->memberList[i]);
+            } else {
+                others.push_back(toaddr);
             }
-
-            *(int *)(&toaddr.addr)= (int) memberNode->memberList[toind].getid() ;
-            *(short *)(&toaddr.addr[4]) = (short) memberNode->memberList[toind].getport();
-            sendPING(&toaddr, memberNode->memberList, &this->failedList, true);
-            this->pingList = toaddr;
         }
+        sendJOINREPFragment(&joinaddr, part, 0, 1, 0);
+        for (int i = 0; i < (int) others.size() && not known; i++) {
+            sendFORWARDJOIN(&others[i], &joinaddr, par->ACTIVE_RWL);
+        }
+    } else {
+        updateMLEFromValues(&mle, &joinaddr, &heartbeat, &memberNode->heartbeat);
+        addMember(&mle);
+        sendJOINREP(&joinaddr, memberNode->memberList);
     }
-
-
-    return;
 }
 
 /**
- * FUNCTION NAME: isNullAddress
+ * FUNCTION NAME: reportJoinLoad
  *
- * DESCRIPTION: Function checks if the address is NULL
+ * DESCRIPTION: Log how many join requests this node handled or relayed, and the message
+ *              load it saw per tick.  Nodes that never saw a JOINREQ stay quiet.
  */
-int MP1Node::isNullAddress(Address *addr) {
-	return (memcmp(addr->addr, NULLADDR, 6) == 0 ? 1 : 0);
+void MP1Node::reportJoinLoad() {
+    if (this->joinReqsHandled + this->joinReqsForwarded == 0) {
+        return;
+    }
+    log->LOG(&memberNode->addr, "#STATSLOG# handled %d JOINREQs (relayed %d, peak %d per tick); peak %d and mean %.2f messages per tick",
+             this->joinReqsHandled, this->joinReqsForwarded, this->peakJoinReqs, this->peakRecv,
+             this->activeTicks > 0 ? (double) this->totalRecv / this->activeTicks : 0.0);
 }
 
 /**
- * FUNCTION NAME: isSameAddress
+ * FUNCTION NAME: mergeMembers
  *
- * DESCRIPTION: Function checks if the address is NULL
+ * DESCRIPTION: Merge the message's membership list into mine in a single pass over both
+ *              lists, sorted by id.  Known members keep the larger heartbeat; only peers I
+ *              did not know are added (and logged).  Senders ship their sorted lists, so
+ *              the incoming list only needs sorting when it is a random sample.  The
+ *              store follows the merge row by row: it always holds merged ++ ml[i..].
  */
-int MP1Node::isSameAddress(Address *addr, Address *addr2) {
-    return (memcmp(addr->addr, addr2->addr, 6) == 0 ? 1 : 0);
+void MP1Node::mergeMembers(MsgView *msg) {
+    vector<MemberListEntry> &ml = memberNode->memberList;
+    vector<MemberListEntry> incoming;
+    vector<MemberListEntry> merged;
+    vector<Address> added;
+    MemberListEntry mle;
+    MemberIter it = msg->getMembers(FIELD_members);
+    Address peeraddr;
+    int i = 0, j = 0;
+    
+    incoming.reserve(it.left());
+    while (it.next(&mle)) {
+        mle.settimestamp(memberNode->heartbeat);
+        incoming.push_back(mle);
+    }
+    if (incoming.empty()) {
+        return;
+    }
+    if (not is_sorted(incoming.begin(), incoming.end(), memberLess)) {
+        sort(incoming.begin(), incoming.end(), memberLess);
+    }
+    
+    merged.reserve(ml.size() + incoming.size());
+    while (i < (int) ml.size() || j < (int) incoming.size()) {
+        if (j >= (int) incoming.size() || (i < (int) ml.size() && memberLess(ml[i], incoming[j]))) {
+            merged.push_back(ml[i++]);
+        } else if (i >= (int) ml.size() || memberLess(incoming[j], ml[i])) {
+            // A peer I did not know, unless the sender listed it twice
+            if (merged.empty() || memberLess(merged.back(), incoming[j])) {
+                *(int *)peeraddr.addr = incoming[j].getid();
+                *(short *)&peeraddr.addr[4] = incoming[j].getport();
+                if (acceptNewMember(&peeraddr)) {
+                    store.insert(merged.size(), incoming[j]);
+                    merged.push_back(incoming[j]);
+                    added.push_back(peeraddr);
+                }
+            }
+            j++;
+        } else {
+            refreshMember(&ml[i], merged.size(), incoming[j].getheartbeat());
+            merged.push_back(ml[i++]);
+            j++;
+        }
+    }
+    ml.swap(merged);
+    
+    for (i = 0; i < (int) added.size(); i++) {
+        memberAdded(&added[i]);
+    }
 }
 
 /**
- * FUNCTION NAME: getJoinAddress
+ * FUNCTION NAME: processFailed
  *
- * DESCRIPTION: Returns the Address of the coordinator
+ * DESCRIPTION: Remove every peer of the message's failed list and remember it as failed.
+ *              A report naming me is refuted instead, and never enters my failed list.
  */
-Address MP1Node::getJoinAddress() {
-    Address joinaddr;
-
-    memset(&joinaddr, 0, sizeof(Address));
-    *(int *)(&joinaddr.addr) = 1;
-    *(short *)(&joinaddr.addr[4]) = 0;
-
-    return joinaddr;
+void MP1Node::processFailed(MsgView *msg) {
+    Address failedaddr;
+    AddrIter it = msg->getAddrs(FIELD_failed);
+    
+    while (it.next(&failedaddr)) {
+        if (isSameAddress(&failedaddr, &memberNode->addr)) {
+            refuteFailed();
+        } else {
+            removeMember(&failedaddr);
+            addFailed(&failedaddr);
+        }
+    }
 }
 
 /**
- * FUNCTION NAME: initMemberListTable
+ * FUNCTION NAME: refuteFailed
  *
- * DESCRIPTION: Initialize the membership list
+ * DESCRIPTION: A peer has declared me failed, which is wrong by construction: I am still
+ *              running.  I do not pass the report on; I refute it with a newer heartbeat
+ *              and take it as a sign of my poor health.  The report is relayed for a while,
+ *              so this happens at most once per probe period.
  */
-void MP1Node::initMemberListTable(Member *memberNode) {
-    memberNode->memberList.clear();
+void MP1Node::refuteFailed() {
+    if (this->refutedAt < 0 || par->getcurrtime() - this->refutedAt >= getProbePeriod()) {
+        bumpHeartbeat();
+        updateLocalHealth(1);
+        this->refutedAt = par->getcurrtime();
+    }
 }
 
 /**
- * FUNCTION NAME: eraseFromPingList
+ * FUNCTION NAME: bumpHeartbeat
  *
- * DESCRIPTION: erase item from the ping list
+ * DESCRIPTION: Advance my heartbeat and keep my own entry fresh, so that the lists I
+ *              gossip carry it
  */
-void MP1Node::eraseFromPingList() {
-    memcpy((char *) this->pingList.addr, this->NULLADDR, sizeof(char[6]));
+void MP1Node::bumpHeartbeat() {
+    int self;
     
+    memberNode->heartbeat++;
+    self = findMember(&memberNode->addr);
+    if (self >= 0) {
+        memberNode->memberList[self].setheartbeat(memberNode->heartbeat);
+        memberNode->memberList[self].settimestamp(memberNode->heartbeat);
+        store.update(self, memberNode->heartbeat, memberNode->heartbeat);
+    }
 }
 
 /**
- * FUNCTION NAME: printAddress
+ * FUNCTION NAME: processLeft
  *
- * DESCRIPTION: Print the Address
+ * DESCRIPTION: Drop every peer of the message's list of departures
  */
-void MP1Node::printAddress(Address *addr)
-{
-    printf("%d.%d.%d.%d:%d \n",  addr->addr[0],addr->addr[1],addr->addr[2],
-                                                       addr->addr[3], *(short*)&addr->addr[4]) ;    
+void MP1Node::processLeft(MsgView *msg) {
+    Address leftaddr;
+    AddrIter it = msg->getAddrs(FIELD_left);
+    
+    while (it.next(&leftaddr)) {
+        memberLeft(&leftaddr);
+    }
 }
 
 /**
- * FUNCTION NAME: getSenderInfo
+ * FUNCTION NAME: memberLeft
  *
- * DESCRIPTION: Get the message type, peer address and heartbeat information.
+ * DESCRIPTION: A peer has left the group.  Remove it and keep a tombstone so that stale
+ *              gossip cannot bring it back; the departure is piggybacked on my pings for
+ *              LEAVE_GOSSIP ticks.
  */
-void MP1Node::getSenderInfo(char *data, MessageHdr *msgHdr, Address *addr, long *heartbeat, char **endptr){
-
-    *endptr = (char *)data;
+void MP1Node::memberLeft(Address *addr) {
+    if (isNullAddress(addr) || isSameAddress(addr, &memberNode->addr) || this->departed.count(addressKey(addr))) {
+        return;
+    }
     
-    memcpy(msgHdr, data, sizeof(int));
-    *endptr +=  sizeof(int);
-    memcpy(&(addr->addr), (char *) data + sizeof(int), sizeof(addr->addr));
-    *endptr +=  sizeof(addr->addr);
-    memcpy((long *) heartbeat, (char *)(data) + sizeof(int) + 1 + sizeof(addr->addr), sizeof(long));
-    *endptr +=  1 + sizeof(long);
-
+    this->departed[addressKey(addr)] = par->getcurrtime();
+    view->removePassive(addr);
+    removeMember(addr, EVENT_LEAVE);
 }
 
 /**
- * FUNCTION NAME: createMLEFromValues
+ * FUNCTION NAME: getLeftList
  *
- * DESCRIPTION: Create a MemberListEntry object with the address, heartbeat and timestamp supplied.
- *              Memory should already have been allocated for the MemberListEntry object.
+ * DESCRIPTION: Departures heard of in the last LEAVE_GOSSIP ticks
  *
+ * RETURNS:
+ * number of departures
  */
-void MP1Node::updateMLEFromValues(MemberListEntry *mle, Address *addr, long *heartbeat, long *timestamp){
-    
-    //memset(mle, 0, sizeof(MemberListEntry));
-    
-    mle->setid ((int)addr->addr[0]);
-    mle->setport((short)addr->addr[4]);
-    mle->setheartbeat(*heartbeat);
-    mle->settimestamp(*timestamp);
-    
-    return;
+int MP1Node::getLeftList(vector<Address> &list) {
+    Address addr;
+    
+    for (map<long, long>::iterator it = this->departed.begin(); it != this->departed.end(); ++it) {
+        if (par->getcurrtime() - it->second < LEAVE_GOSSIP) {
+            addr.init();
+            *(int *)(&addr.addr) = (int) (it->first >> 16);
+            *(short *)(&addr.addr[4]) = (short) (it->first & 0xffff);
+            list.push_back(addr);
+        }
+    }
+    return (int) list.size();
 }
 
 /**
- * FUNCTION NAME: getValuesFromMLE
- *
- * DESCRIPTION: Get the address, heartbeat and timestamp from the MemberListEntry.
+ * FUNCTION NAME: expireTombstones
  *
+ * DESCRIPTION: Forget departures older than TOMBSTONE_TTL ticks
  */
-void MP1Node::getValuesFromMLE(MemberListEntry *mle, Address *addr, long *heartbeat, long *timestamp){
-
-    *(int *)(addr->addr)= (int)mle->getid();
-    *(short *)(&addr->addr[4]) = (short)mle->getport();
-    *heartbeat = mle->getheartbeat();
-    *timestamp = mle->gettimestamp();
-
-    return;
+void MP1Node::expireTombstones() {
+    map<long, long>::iterator it = this->departed.begin();
+    
+    while (it != this->departed.end()) {
+        if (par->getcurrtime() - it->second >= TOMBSTONE_TTL) {
+            it = this->departed.erase(it);
+        } else {
+            ++it;
+        }
+    }
 }
 
 /**
- * FUNCTION NAME: addMember
+ * FUNCTION NAME: nodeLoopOps
+ *
+ * DESCRIPTION: Run the failure detection strategy, then the duties shared by all of them
+ */
+void MP1Node::nodeLoopOps() {
+    Address toaddr;
+
+    protocol->tick(this);
+    expireTombstones();
+    
+    if (par->VIEW_MODE == PARTIAL_VIEW) {
+        partialViewOps();
+    } else if (par->ANTI_ENTROPY_PERIOD > 0 && --this->antiEntropyCounter <= 0) {
+        // Push-pull anti-entropy with a random member
+        this->antiEntropyCounter = par->ANTI_ENTROPY_PERIOD;
+        if (randomMember(&toaddr, &memberNode->addr)) {
+            sendDIGEST(&toaddr);
+        }
+    }
+
+    return;
+}
+
+/**
+ * FUNCTION NAME: swimOps
+ *
+ * DESCRIPTION: Check if any node hasn't responded within a timeout period and then delete
+ * 				the nodes
+ * 				Propagate your membership list
+ */
+void MP1Node::swimOps() {
+    Address toaddr;
+
+    if (memberNode->timeOutCounter > 0)  {
+        memberNode->timeOutCounter--;
+        
+        if (memberNode->pingCounter > 0) {
+            memberNode->pingCounter--;
+            
+            if (memberNode->pingCounter == 0){
+                if (not isNullAddress(&this->pingList) && par->DETECTOR == SWIM_DETECTOR) {
+                    // No response from ping so ask other peers to probe on my behalf
+                    raiseEvent(EVENT_SUSPECT, &this->pingList);
+                    if (tracer) {
+                        tracer->mark(this->pingTrace, *(int *)(memberNode->addr.addr), "suspect");
+                    }
+                    sendIndirectProbes(&this->pingList);
+                }
+            }
+        }
+        
+    }
+    
+    if (memberNode->timeOutCounter <= 0) {
+        // Check for outstanding pings
+        // If outstanding ping
+        //      - delete the member from the member table
+        //      - add member to Failed list
+        
+        if (not isNullAddress(&this->pingList)){
+            MP1_PROBE2(probe_timeout, *(int *)(memberNode->addr.addr), *(int *)(this->pingList.addr));
+            this->probesTimedOut++;
+            if (par->DETECTOR == SWIM_DETECTOR) {
+                // A timeout says nothing about my own health: the target has most likely
+                // crashed, and slowing down would only delay its removal further
+                addFailed(&this->pingList);
+                removeMember(&this->pingList);
+            }
+            eraseFromPingList("timeout");
+        }
+        
+        //      - send out ping to the next peer in this round-robin pass
+        //      - add ping to ping table
+        memberNode->timeOutCounter = getProbePeriod();
+        memberNode->pingCounter = TFAIL;
+        if (probes.nextTarget(&toaddr)){
+            // There is another peer (other than me) in the group that we can ping...
+            memberNode->pingCounter = getProbeTimeout(&toaddr);
+            MP1_PROBE3(probe_start, *(int *)(memberNode->addr.addr), *(int *)(toaddr.addr), memberNode->pingCounter);
+            this->probesStarted++;
+            if (tracer) {
+                this->pingTrace = tracer->startProbe(*(int *)(memberNode->addr.addr), *(int *)(toaddr.addr));
+            }
+            sendPING(&toaddr, &this->failedList, true, this->pingTrace);
+            this->pingList = toaddr;
+            this->pingSentAt = par->getcurrtime();
+        }
+    }
+    
+    if (par->DETECTOR == PHI_DETECTOR) {
+        checkPhiSuspicion();
+    }
+
+    return;
+}
+
+/**
+ * FUNCTION NAME: getPeers
+ *
+ * DESCRIPTION: Addresses of everyone in my list but me
+ */
+void MP1Node::getPeers(vector<Address> &peers) {
+    Address addr;
+    
+    for (int i = 0; i < (int) memberNode->memberList.size(); i++) {
+        addr.init();
+        *(int *)(&addr.addr) = memberNode->memberList[i].getid();
+        *(short *)(&addr.addr[4]) = memberNode->memberList[i].getport();
+        if (not isSameAddress(&addr, &memberNode->addr)) {
+            peers.push_back(addr);
+        }
+    }
+}
+
+/**
+ * FUNCTION NAME: handleHeartbeat
+ *
+ * DESCRIPTION: Refresh the sender of a HEARTBEAT and merge the list it carries
+ */
+void MP1Node::handleHeartbeat(MsgView *msg) {
+    Address peeraddr = msg->getFrom();
+    long heartbeat = msg->getHeartbeat();
+    MemberListEntry mle;
+    
+    updateMLEFromValues(&mle, &peeraddr, &heartbeat, &memberNode->heartbeat);
+    addMember(&mle);
+    mergeMembers(msg);
+    processLeft(msg);
+}
+
+/**
+ * FUNCTION NAME: expireMembers
+ *
+ * DESCRIPTION: Remove, as failed, the members whose heartbeat has not advanced for
+ *              timeout ticks
+ */
+void MP1Node::expireMembers(int timeout) {
+    vector<int32_t> rows;
+    vector<Address> stale;
+    Address addr;
+    int i;
+    
+    store.findStale(memberNode->heartbeat - timeout, rows);
+    for (i = 0; i < (int) rows.size(); i++) {
+        addr.init();
+        *(int *)(&addr.addr) = store.getid(rows[i]);
+        *(short *)(&addr.addr[4]) = store.getport(rows[i]);
+        if (not isSameAddress(&addr, &memberNode->addr)) {
+            stale.push_back(addr);
+        }
+    }
+    for (i = 0; i < (int) stale.size(); i++) {
+        addFailed(&stale[i]);
+        removeMember(&stale[i]);
+    }
+}
+
+/**
+ * FUNCTION NAME: sendIndirectProbes
+ *
+ * DESCRIPTION: Send an INDPING for the ping target through up to IND_PING_K distinct,
+ *              randomly chosen peers (never myself or the target).  The first INDPINGREP
+ *              to come back clears the ping list; any later ones no longer match it.
+ *
+ * RETURNS:
+ * number of INDPINGs sent
+ */
+int MP1Node::sendIndirectProbes(Address *pingaddr) {
+    vector<int> candidates;
+    vector<Address> proxies;
+    Address toaddr;
+    int i, j, k;
+    
+    for (i = 0; i < (int) memberNode->memberList.size(); i++) {
+        if (memberNode->memberList[i].getid() != *(int *)(memberNode->addr.addr) &&
+            memberNode->memberList[i].getid() != *(int *)(pingaddr->addr)) {
+            candidates.push_back(i);
+        }
+    }
+    
+    k = min(par->IND_PING_K, (int) candidates.size());
+    for (i = 0; i < k; i++) {
+        // Partial Fisher-Yates shuffle: pick each proxy from the ones not yet chosen
+        j = i + rand() % (candidates.size() - i);
+        swap(candidates[i], candidates[j]);
+        
+        *(int *)(&toaddr.addr)= (int) memberNode->memberList[candidates[i]].getid() ;
+        *(short *)(&toaddr.addr[4]) = (short) memberNode->memberList[candidates[i]].getport();
+        proxies.push_back(toaddr);
+    }
+    if (k > 0) {
+        sendINDPING(proxies.data(), pingaddr, &memberNode->addr, &this->failedList, this->pingTrace, k);
+    }
+    MP1_PROBE3(probe_indirect, *(int *)(memberNode->addr.addr), *(int *)(pingaddr->addr), k);
+    
+    return k;
+}
+
+/**
+ * FUNCTION NAME: updateLocalHealth
+ *
+ * DESCRIPTION: Adjust the local health multiplier, keeping it within [0, LHM_MAX].
+ */
+void MP1Node::updateLocalHealth(int delta) {
+    this->localHealth = max(0, min(par->LHM_MAX, this->localHealth + delta));
+}
+
+/**
+ * FUNCTION NAME: updatePeerRtt
+ *
+ * DESCRIPTION: Fold a PING->PINGREP round trip sample into the peer's estimate.
+ */
+void MP1Node::updatePeerRtt(Address *addr, long rtt) {
+    int id = *(int *)(addr->addr);
+    unordered_map<int, PeerRtt>::iterator it = this->peerRtt.find(id);
+    
+    if (it == this->peerRtt.end()) {
+        PeerRtt est;
+        est.srtt = rtt;
+        est.rttvar = rtt / 2.0;
+        this->peerRtt[id] = est;
+    } else {
+        it->second.rttvar = 0.75 * it->second.rttvar + 0.25 * fabs(it->second.srtt - rtt);
+        it->second.srtt = 0.875 * it->second.srtt + 0.125 * rtt;
+    }
+}
+
+/**
+ * FUNCTION NAME: getProbeTimeout
+ *
+ * DESCRIPTION: Number of ticks to wait for a PINGREP before falling back to indirect probes.
+ *              This is srtt + 4 * rttvar (at least one tick of slack, at most TFAIL) for the
+ *              target, scaled by the local health multiplier but leaving the indirect probes
+ *              TFAIL ticks before the probe period ends.  Peers without a sample yet get
+ *              TFAIL.
+ */
+int MP1Node::getProbeTimeout(Address *addr) {
+    unordered_map<int, PeerRtt>::iterator it;
+    int timeout = TFAIL;
+    
+    if (not par->ADAPTIVE_TIMEOUT) {
+        return TFAIL;
+    }
+    
+    it = this->peerRtt.find(*(int *)(addr->addr));
+    if (it != this->peerRtt.end()) {
+        timeout = (int) ceil(it->second.srtt + max(1.0, 4 * it->second.rttvar));
+        timeout = min(timeout, TFAIL);
+    }
+    
+    return min(timeout * (1 + this->localHealth), TIMEOUT - TFAIL);
+}
+
+/**
+ * FUNCTION NAME: getProbePeriod
+ *
+ * DESCRIPTION: Number of ticks between probes.  As in Lifeguard, local health stretches
+ *              the probe timeout, not the period: a node in poor health waits longer for
+ *              its acks but keeps probing at the same rate.
+ */
+int MP1Node::getProbePeriod() {
+    return TIMEOUT;
+}
+
+/**
+ * FUNCTION NAME: checkPhiSuspicion
+ *
+ * DESCRIPTION: In phi accrual mode, declare failed every peer whose suspicion level has
+ *              reached PHI_THRESHOLD.  Pings still carry the membership lists that feed
+ *              the detector, but an unanswered ping no longer removes a peer by itself.
+ */
+void MP1Node::checkPhiSuspicion() {
+    vector<Address> suspects;
+    Address peeraddr;
+    long now = par->getcurrtime();
+    double phi;
+    int i;
+    
+    // Arrivals follow the probe period
+    phiDetector->setScale(getProbePeriod(), par->PHI_MIN_STDDEV > 0 ? par->PHI_MIN_STDDEV : 2 * getProbePeriod());
+    for (i = 0; i < (int) memberNode->memberList.size(); i++) {
+        *(int *)(&peeraddr.addr) = memberNode->memberList[i].getid();
+        *(short *)(&peeraddr.addr[4]) = memberNode->memberList[i].getport();
+        if (isSameAddress(&peeraddr, &memberNode->addr)) {
+            continue;
+        }
+        phi = phiDetector->phi(memberNode->memberList[i].getid(), now);
+        if (phi >= par->PHI_THRESHOLD) {
+            suspects.push_back(peeraddr);
+        } else if (phi >= par->PHI_THRESHOLD / 2) {
+            // Halfway to the threshold: tell subscribers once
+            if (this->phiSuspected.insert(memberNode->memberList[i].getid()).second) {
+                raiseEvent(EVENT_SUSPECT, &peeraddr);
+            }
+        } else {
+            this->phiSuspected.erase(memberNode->memberList[i].getid());
+        }
+    }
+    
+    for (i = 0; i < (int) suspects.size(); i++) {
+        addFailed(&suspects[i]);
+        removeMember(&suspects[i]);
+    }
+}
+
+/**
+ * FUNCTION NAME: isNullAddress
+ *
+ * DESCRIPTION: Function checks if the address is NULL
+ */
+int MP1Node::isNullAddress(Address *addr) {
+	return (memcmp(addr->addr, NULLADDR, 6) == 0 ? 1 : 0);
+}
+
+/**
+ * FUNCTION NAME: isSameAddress
+ *
+ * DESCRIPTION: Function checks if the address is NULL
+ */
+int MP1Node::isSameAddress(Address *addr, Address *addr2) {
+    return (memcmp(addr->addr, addr2->addr, 6) == 0 ? 1 : 0);
+}
+
+/**
+ * FUNCTION NAME: getJoinAddress
+ *
+ * DESCRIPTION: Returns the Address of the coordinator
+ */
+Address MP1Node::getJoinAddress() {
+    Address joinaddr;
+    vector<int> seeds;
+    int myid = *(int *)(memberNode->addr.addr);
+    int id = par->SEEDS[0];
+
+    // The first seed boots the group; everyone else asks a random other seed
+    if (myid != id) {
+        for (int i = 0; i < (int) par->SEEDS.size(); i++) {
+            if (par->SEEDS[i] != myid) {
+                seeds.push_back(par->SEEDS[i]);
+            }
+        }
+        id = seeds[rand() % seeds.size()];
+    }
+
+    memset(&joinaddr, 0, sizeof(Address));
+    *(int *)(&joinaddr.addr) = id;
+    *(short *)(&joinaddr.addr[4]) = 0;
+
+    return joinaddr;
+}
+
+/**
+ * FUNCTION NAME: randomMember
+ *
+ * DESCRIPTION: Pick a random member other than myself and except
+ */
+bool MP1Node::randomMember(Address *addr, Address *except) {
+    vector<int> candidates;
+    int i;
+    
+    for (i = 0; i < (int) memberNode->memberList.size(); i++) {
+        if (memberNode->memberList[i].getid() != *(int *)(memberNode->addr.addr) &&
+            memberNode->memberList[i].getid() != *(int *)(except->addr)) {
+            candidates.push_back(i);
+        }
+    }
+    if (candidates.empty()) {
+        return false;
+    }
+    
+    i = candidates[rand() % candidates.size()];
+    *(int *)(&addr->addr) = memberNode->memberList[i].getid();
+    *(short *)(&addr->addr[4]) = memberNode->memberList[i].getport();
+    return true;
+}
+
+/**
+ * FUNCTION NAME: initMemberListTable
+ *
+ * DESCRIPTION: Initialize the membership list
+ */
+void MP1Node::initMemberListTable(Member *memberNode) {
+    memberNode->memberList.clear();
+    store.clear();
+    probes.clear();
+    phiDetector->clear();
+}
+
+/**
+ * FUNCTION NAME: eraseFromPingList
+ *
+ * DESCRIPTION: erase item from the ping list, ending the trace of the probe with outcome
+ */
+void MP1Node::eraseFromPingList(const char *outcome) {
+    memcpy((char *) this->pingList.addr, this->NULLADDR, sizeof(char[6]));
+    if (tracer) {
+        tracer->endProbe(this->pingTrace, *(int *)(memberNode->addr.addr), outcome);
+    }
+    this->pingTrace = 0;
+}
+
+/**
+ * FUNCTION NAME: printAddress
+ *
+ * DESCRIPTION: Print the Address
+ */
+void MP1Node::printAddress(Address *addr)
+{
+    printf("%d.%d.%d.%d:%d \n",  addr->addr[0],addr->addr[1],addr->addr[2],
+                                                       addr->addr[3], *(short*)&addr->addr[4]) ;    
+}
+
+/**
+ * FUNCTION NAME: updateMLEFromValues
+ *
+ * DESCRIPTION: Create a MemberListEntry object with the address, heartbeat and timestamp supplied.
+ *              Memory should already have been allocated for the MemberListEntry object.
+ *
+ */
+void MP1Node::updateMLEFromValues(MemberListEntry *mle, Address *addr, long *heartbeat, long *timestamp){
+    
+    mle->setid (*(int *)(addr->addr));
+    mle->setport(*(short *)(&addr->addr[4]));
+    mle->setheartbeat(*heartbeat);
+    mle->settimestamp(*timestamp);
+    
+    return;
+}
+
+/**
+ * FUNCTION NAME: getValuesFromMLE
+ *
+ * DESCRIPTION: Get the address, heartbeat and timestamp from the MemberListEntry.
+ *
+ */
+void MP1Node::getValuesFromMLE(MemberListEntry *mle, Address *addr, long *heartbeat, long *timestamp){
+
+    *(int *)(addr->addr)= (int)mle->getid();
+    *(short *)(&addr->addr[4]) = (short)mle->getport();
+    *heartbeat = mle->getheartbeat();
+    *timestamp = mle->gettimestamp();
+
+    return;
+}
+
+/**
+ * FUNCTION NAME: findMember
+ *
+ * DESCRIPTION: Binary search of the sorted membership list
+ *
+ * RETURNS:
+ * index of the entry for addr, or -1
+ */
+int MP1Node::findMember(Address *addr) {
+    MemberListEntry key(*(int *)(addr->addr), *(short *)(&addr->addr[4]));
+    vector<MemberListEntry>::iterator it = lower_bound(memberNode->memberList.begin(), memberNode->memberList.end(), key, memberLess);
+    
+    if (it == memberNode->memberList.end() || memberLess(key, *it)) {
+        return -1;
+    }
+    return it - memberNode->memberList.begin();
+}
+
+/**
+ * FUNCTION NAME: acceptNewMember
+ *
+ * DESCRIPTION: Decide whether a peer missing from my list may be added.  Failed peers and
+ *              peers that left are not; in partial-view mode peers outside my active view go
+ *              to the passive view.
+ */
+bool MP1Node::acceptNewMember(Address *peeraddr) {
+    if (isFailed(peeraddr) || this->departed.count(addressKey(peeraddr))) {
+        // do nothing because this is a Failed Node or one that left.
+        return false;
+    }
+    if (par->VIEW_MODE == PARTIAL_VIEW && not isSameAddress(&memberNode->addr, peeraddr) &&
+        not view->isActive(peeraddr)) {
+        // In partial-view mode my list only holds my active view; anyone else I hear
+        // about is kept in reserve
+        view->addPassive(peeraddr);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * FUNCTION NAME: memberAdded
+ *
+ * DESCRIPTION: Start probing and tracking a peer that has just entered my list
+ */
+void MP1Node::memberAdded(Address *peeraddr) {
+    if (not isSameAddress(&memberNode->addr, peeraddr)) {
+        probes.add(peeraddr);
+        phiDetector->heartbeat(*(int *)(peeraddr->addr), par->getcurrtime());
+    }
+    raiseEvent(EVENT_JOIN, peeraddr);
+    log->logNodeAdd(&(memberNode->addr), peeraddr );
+}
+
+/**
+ * FUNCTION NAME: notePeerAlive
+ *
+ * DESCRIPTION: Record an arrival for a member I have just heard from directly (any message
+ *              it sent me) or through an indirect ack.  Gossiped heartbeats are recorded by
+ *              refreshMember.
+ */
+void MP1Node::notePeerAlive(Address *peeraddr) {
+    if (par->DETECTOR == PHI_DETECTOR && findMember(peeraddr) >= 0 &&
+        not isSameAddress(peeraddr, &memberNode->addr)) {
+        phiDetector->heartbeat(*(int *)(peeraddr->addr), par->getcurrtime());
+    }
+}
+
+/**
+ * FUNCTION NAME: refreshMember
+ *
+ * DESCRIPTION: Fold a newer heartbeat into an existing entry, at index row of the list and
+ *              the store.  Older or equal heartbeats, e.g. from stale gossip, leave the
+ *              entry untouched.
+ */
+void MP1Node::refreshMember(MemberListEntry *mle, int row, long heartbeat) {
+    if (heartbeat > mle->getheartbeat()) {
+        phiDetector->heartbeat(mle->getid(), par->getcurrtime());
+        mle->setheartbeat(heartbeat);
+        mle->settimestamp(memberNode->heartbeat);
+        store.update(row, heartbeat, memberNode->heartbeat);
+    }
+}
+
+/**
+ * FUNCTION NAME: addMember
+ *
+ * DESCRIPTION: Add member to member list, keeping the list sorted by id.
+ *
+ */
+void MP1Node::addMember(MemberListEntry *peer) {
+    MemberListEntry mle(peer->getid(), peer->getport(), peer->getheartbeat(), memberNode->heartbeat);
+    Address peeraddr;
+    int i;
+    
+    *(int *)peeraddr.addr = (int) peer->getid();
+    *(short *)&peeraddr.addr[4] = (short) peer->getport();
+    
+    i = findMember(&peeraddr);
+    if (i >= 0) {
+        // Update existing member
+        refreshMember(&memberNode->memberList[i], i, peer->getheartbeat());
+    } else if (acceptNewMember(&peeraddr)) {
+        // Add new member to the list
+        vector<MemberListEntry>::iterator pos = upper_bound(memberNode->memberList.begin(), memberNode->memberList.end(), mle, memberLess);
+        store.insert(pos - memberNode->memberList.begin(), mle);
+        memberNode->memberList.insert(pos, mle);
+        MP1_PROBE3(member_add, *(int *)(memberNode->addr.addr), (int) peer->getid(), peer->getheartbeat());
+        memberAdded(&peeraddr);
+    }
+    
+    return;
+}
+
+/**
+ * FUNCTION NAME: removeMember
+ *
+ * DESCRIPTION: Remove member from member list.  reason is the event raised for it:
+ *              EVENT_FAIL, or EVENT_LEAVE for a peer that left or was dropped from my
+ *              view.  A live peer merely dropped from my partial view (dropped) is still
+ *              in the group, so its removal is not logged.
+ *
+ */
+void MP1Node::removeMember(Address *peeraddr, int reason, bool dropped) {
+    int i;
+    
+    if (isNullAddress(peeraddr)) { return;}
+    
+    i = findMember(peeraddr);
+    if (i >= 0) {
+        if (reason == EVENT_FAIL && not dropped) {
+            cout<<"Found a failed peer in the list, removing..."<<endl;
+        }
+        MP1_PROBE3(member_remove, *(int *)(memberNode->addr.addr), *(int *)(peeraddr->addr), reason);
+        memberNode->memberList.erase(memberNode->memberList.begin()+i);
+        store.erase(i);
+        probes.remove(peeraddr);
+        phiDetector->remove(*(int *)peeraddr->addr);
+        phiSuspected.erase(*(int *)peeraddr->addr);
+        view->removeActive(peeraddr);
+        raiseEvent(reason, peeraddr);
+        if (not dropped) {
+            log->logNodeRemove(&(memberNode->addr), peeraddr );
+        }
+    }
+    
+    return;
+}
+
+
+/**
+ * FUNCTION NAME: addFailed
+ *
+ * DESCRIPTION: Add failed peer to list.
+ *
+ */
+void MP1Node::addFailed(Address *addr) {
+    int i = 0;
+    int foundind = i;
+    bool found = false;
+    
+    if (isNullAddress(addr)) { return; }
+    
+    if (not (isSameAddress(&this->failedList, addr) ||
+             isSameAddress(&this->failedList1, addr) ||
+             isSameAddress(&this->failedList2, addr) ||
+             isSameAddress(&this->failedList3, addr) ||
+             isSameAddress(&this->failedList4, addr)))
+   {
+       MP1_PROBE2(failed_add, *(int *)(memberNode->addr.addr), *(int *)(addr->addr));
+       view->removePassive(addr);
+       if (this->cntfailed == 0) {
+           this->failedList = *addr;
+           this->cntfailed++;
+       } else if (this->cntfailed == 1) {
+           this->failedList1 = *addr;
+           this->cntfailed++;
+       } else if (this->cntfailed == 2) {
+           this->failedList2 = *addr;
+           this->cntfailed++;
+       } else if (this->cntfailed == 3) {
+           this->failedList3 = *addr;
+           this->cntfailed++;
+       } else if (this->cntfailed == 4) {
+           this->failedList4 = *addr;
+           this->cntfailed++;
+       } else {
+           //My code doesn't cope with this because I kept getting malloc issues
+           // every time I tried to add anything that was a pointer to the MP1Node.h
+       }
+    }
+    
+    return;
+}
+/**
+ * FUNCTION NAME: isFailed
+ *
+ * DESCRIPTION: Function checks if the address is in the failed list
+ */
+int MP1Node::isFailed(Address *addr) {
+    return (isSameAddress(&this->failedList, addr) ||
+            isSameAddress(&this->failedList1, addr) ||
+            isSameAddress(&this->failedList2, addr) ||
+            isSameAddress(&this->failedList3, addr) ||
+            isSameAddress(&this->failedList4, addr)) ? 1 : 0;
+}
+
+/**
+ * FUNCTION NAME: addNeighbor
+ *
+ * DESCRIPTION: Partial-view mode: move a peer into my active view and member list.  If the
+ *              view is full a random neighbour is evicted to the passive view and told so.
+ */
+void MP1Node::addNeighbor(Address *addr, long heartbeat) {
+    MemberListEntry mle;
+    Address evicted;
+    
+    if (isSameAddress(addr, &memberNode->addr) || isFailed(addr) || view->isActive(addr)) {
+        return;
+    }
+    if (view->addActive(addr, &evicted)) {
+        sendDISCONNECT(&evicted);
+        dropNeighbor(&evicted);
+    }
+    updateMLEFromValues(&mle, addr, &heartbeat, &memberNode->heartbeat);
+    addMember(&mle);
+}
+
+/**
+ * FUNCTION NAME: dropNeighbor
+ *
+ * DESCRIPTION: Partial-view mode: take a live peer out of my member list without treating
+ *              it as failed
+ */
+void MP1Node::dropNeighbor(Address *addr) {
+    removeMember(addr, EVENT_LEAVE, true);
+    if (isSameAddress(&this->pingList, addr)) {
+        eraseFromPingList("dropped");
+    }
+}
+
+/**
+ * FUNCTION NAME: partialViewOps
+ *
+ * DESCRIPTION: Partial-view mode duties of each tick: periodically shuffle a sample of my
+ *              views along a random walk, and refill the active view from the passive one
+ *              after failures, one NEIGHBOR request at a time.  A passive peer that does
+ *              not answer in time is presumed gone and forgotten.
+ */
+void MP1Node::partialViewOps() {
+    Address toaddr;
+    vector<Address> nodes;
+    long now = par->getcurrtime();
+    
+    if (--this->shuffleCounter <= 0) {
+        this->shuffleCounter = par->SHUFFLE_PERIOD;
+        if (view->randomActive(&toaddr, NULL)) {
+            nodes.push_back(memberNode->addr);
+            view->sample(nodes, par->SHUFFLE_KA, par->SHUFFLE_KP);
+            sendSHUFFLE(&toaddr, &memberNode->addr, par->ACTIVE_RWL, nodes);
+        }
+    }
+    
+    if (not isNullAddress(&this->neighborPending) && now >= this->neighborPendingUntil) {
+        view->removePassive(&this->neighborPending);
+        memcpy((char *) this->neighborPending.addr, this->NULLADDR, sizeof(char[6]));
+    }
+    if (isNullAddress(&this->neighborPending) && not view->activeFull() && view->randomPassive(&toaddr)) {
+        sendNEIGHBOR(&toaddr, view->activeCount() == 0);
+        this->neighborPending = toaddr;
+        this->neighborPendingUntil = now + 2 * TFAIL;
+    }
+}
+
+/**
+ * FUNCTION NAME: handleForwardJoin
+ *
+ * DESCRIPTION: Partial-view mode: a join walk for a new node.  The walk ends here when its
+ *              time to live runs out or I have no other neighbour, and then the new node
+ *              joins my active view; on the way it is left in passive views at PASSIVE_RWL.
+ */
+void MP1Node::handleForwardJoin(MsgView *msg) {
+    Address peeraddr = msg->getFrom();
+    Address joinaddr = msg->getAddr(FIELD_target);
+    Address toaddr;
+    int ttl = (int) msg->getUint(FIELD_ttl);
+    
+    if (isSameAddress(&joinaddr, &memberNode->addr) || isFailed(&joinaddr)) {
+        return;
+    }
+    
+    if (ttl > 0 && view->activeCount() > 1 && view->randomActive(&toaddr, &peeraddr) &&
+        not isSameAddress(&toaddr, &joinaddr)) {
+        if (ttl == par->PASSIVE_RWL) {
+            view->addPassive(&joinaddr);
+        }
+        sendFORWARDJOIN(&toaddr, &joinaddr, ttl - 1);
+        return;
+    }
+    
+    if (not view->isActive(&joinaddr)) {
+        addNeighbor(&joinaddr, 0);
+        sendNEIGHBOR(&joinaddr, true);
+    }
+}
+
+/**
+ * FUNCTION NAME: handleShuffle
+ *
+ * DESCRIPTION: Partial-view mode: pass a shuffle on along the walk, or end it here by
+ *              answering the origin with as many of my passive peers and keeping theirs
+ */
+void MP1Node::handleShuffle(MsgView *msg) {
+    Address peeraddr = msg->getFrom();
+    Address origin = msg->getAddr(FIELD_origin);
+    Address toaddr;
+    Address addr;
+    vector<Address> nodes;
+    AddrIter it;
+    int ttl = (int) msg->getUint(FIELD_ttl);
+    
+    if (isSameAddress(&origin, &memberNode->addr)) {
+        return;
+    }
+    
+    if (ttl > 0 && view->activeCount() > 1 && view->randomActive(&toaddr, &peeraddr)) {
+        for (it = msg->getAddrs(FIELD_nodes); it.next(&addr); ) {
+            nodes.push_back(addr);
+        }
+        sendSHUFFLE(&toaddr, &origin, ttl - 1, nodes);
+        return;
+    }
+    
+    view->sample(nodes, 0, msg->getCount(FIELD_nodes));
+    sendSHUFFLEREP(&origin, nodes);
+    integrateShuffle(msg);
+}
+
+/**
+ * FUNCTION NAME: integrateShuffle
+ *
+ * DESCRIPTION: Partial-view mode: keep the peers of a shuffle in my passive view
+ */
+void MP1Node::integrateShuffle(MsgView *msg) {
+    Address addr;
+    AddrIter it = msg->getAddrs(FIELD_nodes);
+    
+    while (it.next(&addr)) {
+        if (not isSameAddress(&addr, &memberNode->addr) && not isFailed(&addr)) {
+            view->addPassive(&addr);
+        }
+    }
+}
+
+/**
+ * FUNCTION NAME: handleDigest
+ *
+ * DESCRIPTION: Anti-entropy, first step on the receiving side: compare the sender's
+ *              digest with mine and send back my entries of every bucket that differs
+ */
+void MP1Node::handleDigest(MsgView *msg) {
+    Address peeraddr = msg->getFrom();
+    vector<unsigned long> other;
+    vector<unsigned long> differing;
+    vector<MemberListEntry> entries;
+    unsigned long v;
+    UintIter it = msg->getUints(FIELD_digest);
+    
+    while (it.next(&v)) {
+        other.push_back(v);
+    }
+    digest->build(memberNode->memberList);
+    digest->diff(other, differing);
+    if (differing.empty()) {
+        return;
+    }
+    digest->select(memberNode->memberList, differing, entries);
+    sendDIGESTREP(&peeraddr, differing, entries);
+}
+
+/**
+ * FUNCTION NAME: handleDigestRep
+ *
+ * DESCRIPTION: Anti-entropy, back at the initiator: merge the peer's entries of the
+ *              differing buckets and push mine of the same buckets in return
+ */
+void MP1Node::handleDigestRep(MsgView *msg) {
+    Address peeraddr = msg->getFrom();
+    vector<unsigned long> differing;
+    vector<MemberListEntry> entries;
+    unsigned long v;
+    UintIter it = msg->getUints(FIELD_buckets);
+    
+    while (it.next(&v)) {
+        differing.push_back(v);
+    }
+    digest->select(memberNode->memberList, differing, entries);
+    mergeMembers(msg);
+    sendDIGESTPUSH(&peeraddr, entries);
+}
+
+/**
+ * FUNCTION NAME: getFailedList
  *
- * DESCRIPTION: Add member to member list.
+ * DESCRIPTION: Copy the non-null failed peers into list, which must hold 5 addresses.
  *
+ * RETURNS:
+ * number of failed peers
  */
-void MP1Node::addMember(MemberListEntry *peer) {
-    MemberListEntry *mle;
-    Address peeraddr;
-    int i = 0;
-    int foundind = i;
-    bool found = false;
-    
-    
-    *(int *)peeraddr.addr = (int) peer->getid();
-    *(short *)&peeraddr.addr[4] = (short) peer->getport();
-    
-    while (i < memberNode->memberList.size() && not(found)) {
-        if (peer->getid() == memberNode->memberList[i].getid() &&
-            peer->getport()== memberNode->memberList[i].getport()) {
-            cout<<"Found a match in the list"<<endl;
-            found = true;
-            foundind = i;
+int MP1Node::getFailedList(Address *list) {
+    Address *slots[5] = { &this->failedList, &this->failedList1, &this->failedList2,
+                          &this->failedList3, &this->failedList4 };
+    int n = 0;
+    
+    for (int i = 0; i < 5; i++) {
+        if (not isNullAddress(slots[i])) {
+            list[n++] = *slots[i];
         }
-        i++;
     }
-    
-    if (found) {
-        // Update existing member
-        memberNode->memberList[foundind].setheartbeat(peer->getheartbeat());
-        memberNode->memberList[foundind].settimestamp(memberNode->heartbeat);
-    } else if(isSameAddress(&this->failedList, &peeraddr) ||
-               isSameAddress(&this->failedList1, &peeraddr) ||
-              isSameAddress(&this->failedList2, &peeraddr) ||
-              isSameAddress(&this->failedList3, &peeraddr)||
-              isSameAddress(&this->failedList4, &peeraddr)){
-        // do nothing because this is a Failed Node.
-    } else {
-        // Add new member to the list
-        mle = (MemberListEntry *) malloc (sizeof(MemberListEntry));
-        mle->setid (peer->getid());
-        mle->setport(peer->getport());
-        mle->setheartbeat(peer->getheartbeat());
-        mle->settimestamp(memberNode->heartbeat);
-        memberNode->memberList.push_back(*mle);
-        log->logNodeAdd(&(memberNode->addr), &peeraddr );
-        free(mle);
+    return n;
+}
+
+/**
+ * FUNCTION NAME: transmit
+ *
+ * DESCRIPTION: Hand one packet to the network, counting what it costs me
+ *
+ * RETURNS:
+ * number of bytes sent, 0 if the network dropped it
+ */
+int MP1Node::transmit(Address *toaddr, const char *data, int size) {
+    this->bytesSent += size;
+    this->packetsSent++;
+    return emulNet->ENsend(&memberNode->addr, toaddr, (char *) data, size);
+}
+
+/**
+ * FUNCTION NAME: sendMessage
+ *
+ * DESCRIPTION: Encode the message and queue it in the frame for its destination.  The
+ *              frame goes out at the end of the tick, or earlier if it is full.  With
+ *              BATCH_MSGS off, or for a message too large for any frame, it is sent at once.
+ *
+ * RETURNS:
+ * number of bytes queued or sent, 0 if the network dropped it
+ */
+int MP1Node::sendMessage(Address *toaddr, MsgBuilder *msg) {
+    int msgsize = msg->encodedSize();
+    // Largest payload ENsend accepts
+    int cap = par->MAX_MSG_SIZE - (int) sizeof(en_msg) - 1;
+    char *buf;
+    int ret;
+    
+    if (par->BATCH_MSGS) {
+        OutFrame &frame = this->outbox[addressKey(toaddr)];
+        frame.to = *toaddr;
+        if (frame.batch.append(msg, msgsize, cap)) {
+            return msgsize;
+        }
+        if (frame.batch.count() > 0) {
+            transmit(&frame.to, frame.batch.data(), frame.batch.size());
+            frame.batch.clear();
+            if (frame.batch.append(msg, msgsize, cap)) {
+                return msgsize;
+            }
+        }
     }
     
-    return;
+    buf = (char *) malloc(msgsize * sizeof(char));
+    msg->encode(buf, msgsize, msgsize);
+    ret = transmit(toaddr, buf, msgsize);
+    free(buf);
+    
+    return ret;
 }
 
 /**
- * FUNCTION NAME: removeMember
+ * FUNCTION NAME: multicastMessage
  *
- * DESCRIPTION: Remove member from member list.
+ * DESCRIPTION: Send the same message to n peers.  It is encoded once and handed to the
+ *              network as a single multicast, outside the per-destination frames; a
+ *              message for one peer goes through sendMessage as usual.
  *
+ * RETURNS:
+ * number of peers it was sent to
  */
-void MP1Node::removeMember(Address *peeraddr) {
-    int i;
+int MP1Node::multicastMessage(Address *toaddrs, int n, MsgBuilder *msg) {
+    int msgsize;
+    char *buf;
+    int ret;
     
-    if (isNullAddress(peeraddr)) { return;}
-    
-    for (i= 0; i < memberNode->memberList.size(); i++) {
-        if (memberNode->memberList[i].getid() == *(int *)peeraddr->addr &&
-            memberNode->memberList[i].getport() == *(short *) &peeraddr->addr[4]) {
-                cout<<"Found a failed peer in the list, removing..."<<endl;
-                memberNode->memberList.erase(memberNode->memberList.begin()+i);
-                log->logNodeRemove(&(memberNode->addr), peeraddr );
-        }
+    if (n <= 1) {
+        return (n == 1 && sendMessage(toaddrs, msg) > 0) ? 1 : 0;
     }
     
-    return;
+    msgsize = msg->encodedSize();
+    buf = (char *) malloc(msgsize * sizeof(char));
+    msg->encode(buf, msgsize, msgsize);
+    this->bytesSent += (long) msgsize * n;
+    this->packetsSent += n;
+    ret = emulNet->ENmulticast(&memberNode->addr, toaddrs, n, buf, msgsize);
+    free(buf);
+    
+    return ret;
 }
 
-
 /**
- * FUNCTION NAME: addFailed
+ * FUNCTION NAME: flushMessages
  *
- * DESCRIPTION: Add failed peer to list.
+ * DESCRIPTION: Send every queued frame as a single packet.  The outbox only holds the
+ *              destinations of this tick, so it is emptied afterwards.
+ */
+void MP1Node::flushMessages() {
+    for (map<long, OutFrame>::iterator it = this->outbox.begin(); it != this->outbox.end(); it++) {
+        if (it->second.batch.count() > 0) {
+            transmit(&it->second.to, it->second.batch.data(), it->second.batch.size());
+        }
+    }
+    this->outbox.clear();
+}
+
+/**
+ * FUNCTION NAME: sendJOINREQ
  *
+ * DESCRIPTION: Send JOINREQ message.  The message structure is:
+ *                  JOINREQ
+ *                  memberNode->addr.addr
+ *                  memberNode->heartbeat
+ *                  joinpeer->addr.addr and relay hops left (only when relaying
+ *                  someone else's request)
  */
-void MP1Node::addFailed(Address *addr) {
-    int i = 0;
-    int foundind = i;
-    bool found = false;
+void MP1Node::sendJOINREQ(Address *toaddr, Address *joinaddr, int hops) {
+    MsgBuilder msg(JOINREQ, &memberNode->addr, memberNode->heartbeat);
     
-    if (isNullAddress(addr)) { return; }
-    
-    if (not (isSameAddress(&this->failedList, addr) ||
-             isSameAddress(&this->failedList1, addr) ||
-             isSameAddress(&this->failedList2, addr) ||
-             isSameAddress(&this->failedList3, addr) ||
-             isSameAddress(&this->failedList4, addr)))
-   {
-       if (this->cntfailed == 0) {
-           this->failedList = *addr;
-           this->cntfailed++;
-       } else if (this->cntfailed == 1) {
-           this->failedList1 = *addr;
-           this->cntfailed++;
-       } else if (this->cntfailed == 2) {
-           this->failedList2 = *addr;
-           this->cntfailed++;
-       } else if (this->cntfailed == 3) {
-           this->failedList3 = *addr;
-           this->cntfailed++;
-       } else if (this->cntfailed == 4) {
-           this->failedList4 = *addr;
-           this->cntfailed++;
-       } else {
-           //My code doesn't cope with this because I kept getting malloc issues
-           // every time I tried to add anything that was a pointer to the MP1Node.h
-       }
+    if (joinaddr != NULL) {
+        msg.setAddr(FIELD_origin, joinaddr);
+        msg.setUint(FIELD_ttl, hops);
     }
+    sendMessage(toaddr, &msg);
     
     return;
 }
+
 /**
- * FUNCTION NAME: createMessageHdr
- *
- * DESCRIPTION: Create a message header for the current member.  Memory for the message should
- *              have already been allocated.
+ * FUNCTION NAME: sendJOINREP
  *
+ * DESCRIPTION: Send the membership list to a joining peer.  Depending on JOIN_VIEW this is
+ *              the whole list in one message (full), the whole list split over as many
+ *              sequenced fragments as needed to stay under MAX_MSG_SIZE (fragment), or a
+ *              random sample of JOIN_SAMPLE_SIZE entries that gossip completes later (sample).
  */
-void MP1Node::createMessageHdr(MessageHdr *msg, MsgTypes msgtype, Address *addr, long heartbeat, char **endptr){
+void MP1Node::sendJOINREP(Address *toaddr, std::vector<MemberListEntry> &ml) {
+    vector<MemberListEntry> part;
+    vector<int> cut;
+    int total = ml.size();
+    int i, j, budget, used;
+    long previd;
+    
+    if (par->JOIN_VIEW == SAMPLE_JOINVIEW && total > par->JOIN_SAMPLE_SIZE) {
+        vector<int> idx;
+        for (i = 0; i < total; i++) {
+            // The joiner and I always go in; the rest are picked at random
+            if (ml[i].getid() == *(int *)(toaddr->addr) || ml[i].getid() == *(int *)(memberNode->addr.addr)) {
+                part.push_back(ml[i]);
+            } else {
+                idx.push_back(i);
+            }
+        }
+        for (i = 0; i < (int) idx.size() && (int) part.size() < par->JOIN_SAMPLE_SIZE; i++) {
+            j = i + rand() % (idx.size() - i);
+            swap(idx[i], idx[j]);
+            part.push_back(ml[idx[i]]);
+        }
+        sort(part.begin(), part.end(), memberLess);
+        sendJOINREPFragment(toaddr, part, 0, 1, total);
+        return;
+    }
+    
+    if (par->JOIN_VIEW == FULL_JOINVIEW) {
+        sendJOINREPFragment(toaddr, ml, 0, 1, total);
+        return;
+    }
     
-    *endptr = (char *)msg; // endptr points to the current end of data
+    // Split greedily so every fragment fits in one packet, leaving room for the header,
+    // the fragment numbers and the batch framing
+    budget = par->MAX_MSG_SIZE - (int) sizeof(en_msg) - 1 - MSG_HDR_SIZE - BATCH_HDR_SIZE - 4 * 10;
+    cut.push_back(0);
+    used = 0;
+    previd = 0;
+    for (i = 0; i < total; i++) {
+        if (used + memberEntrySize(ml[i], previd) > budget) {
+            cut.push_back(i);
+            used = 0;
+            previd = 0;
+        }
+        used += memberEntrySize(ml[i], previd);
+        previd = ml[i].getid();
+    }
+    cut.push_back(total);
     
-    msg->msgType = msgtype;
-    *endptr +=  sizeof(int);
-    memcpy((char *)(msg+1), addr->addr, sizeof(addr->addr));
-    *endptr += sizeof(addr->addr) + 1;
-    memcpy((char *)(msg+1) + 1 + sizeof(addr->addr), &heartbeat, sizeof(long));
-    *endptr += sizeof(long);
+    for (i = 0; i + 1 < (int) cut.size(); i++) {
+        part.assign(ml.begin() + cut[i], ml.begin() + cut[i + 1]);
+        sendJOINREPFragment(toaddr, part, i, cut.size() - 1, total);
+    }
     
     return;
 }
 
 /**
- * FUNCTION NAME: sendJOINREP
+ * FUNCTION NAME: sendJOINREPFragment
  *
- * DESCRIPTION: Send JOINREP message response.  The message table is appended after the
- *              heartbeat.  So message structure is:
+ * DESCRIPTION: Send one JOINREP message.  The message structure is:
  *                  JOINREP
  *                  memberNode->addr.addr
  *                  memberNode->heartbeat
- *                  memberNode->memberList
+ *                  fragment number, number of fragments, size of my list
+ *                  part of memberNode->memberList
  */
-void MP1Node::sendJOINREP(Address *toaddr, std::vector<MemberListEntry> ml) {
-    MessageHdr *msg;
-    char *ptr;
-    MemberListEntry *mle;
+void MP1Node::sendJOINREPFragment(Address *toaddr, std::vector<MemberListEntry> &ml, int fragment, int fragments, int total) {
+    MsgBuilder msg(JOINREP, &memberNode->addr, memberNode->heartbeat);
 #ifdef DEBUGLOG
     static char s[1024];
 #endif
     
-    size_t msgsize = sizeof(MessageHdr) + sizeof(toaddr->addr) + sizeof(long) + 1
-    + (sizeof(int)+sizeof(short)+sizeof(long))*ml.size();
-    msg = (MessageHdr *) malloc(msgsize * sizeof(char));
-    
-    // create JOINREP message: format of data is
-    createMessageHdr(msg, JOINREP, &memberNode->addr, memberNode->heartbeat, &ptr);
-    // ptr points to the end of the message header so fill data from there
-    for (int i = 0; i < ml.size(); i++) {
-        mle = &ml[i];
-        *ptr = (int) mle->getid();
-        ptr += sizeof(int);
-        *ptr = (short) mle->getport();
-        ptr += sizeof(short);
-        *ptr = (long) mle->getheartbeat();
-        ptr += sizeof(long);
-    }
-
+    msg.setUint(FIELD_fragment, fragment);
+    msg.setUint(FIELD_fragments, fragments);
+    msg.setUint(FIELD_total, total);
+    msg.setMembers(FIELD_members, &ml);
     
     cout << "Sending JOINREP: " << memberNode->addr.addr <<" heartbeat: " << memberNode->heartbeat << endl;
 #ifdef DEBUGLOG
@@ -792,13 +2030,47 @@ void MP1Node::sendJOINREP(Address *toaddr, std::vector<MemberListEntry> ml) {
 #endif
     
     // send JOINREP message to new peer
-    emulNet->ENsend(&memberNode->addr, toaddr, (char *)msg, msgsize);
-    
-    free(msg);
+    sendMessage(toaddr, &msg);
     
     return;
 }
 
+/**
+ * FUNCTION NAME: checkFullView
+ *
+ * DESCRIPTION: Record the first tick at which my list holds as many members as the
+ *              introducer had when I joined, and report how long that took.
+ */
+void MP1Node::checkFullView() {
+    int fragments = 0;
+    
+    if (this->joinViewTarget == 0 || this->fullViewTime >= 0 ||
+        (int) memberNode->memberList.size() < this->joinViewTarget) {
+        return;
+    }
+    
+    this->fullViewTime = par->getcurrtime();
+    for (int i = 0; i < (int) this->joinFragments.size(); i++) {
+        fragments += this->joinFragments[i] ? 1 : 0;
+    }
+    log->LOG(&memberNode->addr, "#STATSLOG# full view of %d members %ld ticks after join request (%d/%d JOINREP fragments)",
+             this->joinViewTarget, this->fullViewTime - this->joinStartTime, fragments, (int) this->joinFragments.size());
+}
+
+/**
+ * FUNCTION NAME: traceSent
+ *
+ * DESCRIPTION: Record a message of a traced probe sent to n peers
+ */
+void MP1Node::traceSent(unsigned long trace, Address *toaddrs, int n, MsgTypes type) {
+    if (tracer == NULL || trace == 0) {
+        return;
+    }
+    for (int i = 0; i < n; i++) {
+        tracer->sent(trace, *(int *)(memberNode->addr.addr), *(int *)(toaddrs[i].addr), type);
+    }
+}
+
 /**
  * FUNCTION NAME: sendPING
  *
@@ -806,52 +2078,43 @@ void MP1Node::sendJOINREP(Address *toaddr, std::vector<MemberListEntry> ml) {
  *                  PING
  *                  memberNode->addr.addr
  *                  memberNode->heartbeat
+ *                  memberNode->memberList (encoded from store, or a sample of it)
  *                  FAILED
  *                  failedpeer->addr
+ *                  LEFT
+ *                  departed peers
  */
-void MP1Node::sendPING(Address *toaddr, std::vector<MemberListEntry> ml, Address *faddress, bool fromme) {
-    MessageHdr *msg;
-    char *ptr;
-    MemberListEntry *mle;
+void MP1Node::sendPING(Address *toaddr, Address *faddress, bool fromme, unsigned long trace) {
+    MsgBuilder msg(PING, &memberNode->addr, memberNode->heartbeat);
+    vector<MemberListEntry> &ml = memberNode->memberList;
+    vector<MemberListEntry> sample;
+    Address failed[5];
+    vector<Address> left;
 #ifdef DEBUGLOG
     static char s[1024];
 #endif
     
-    size_t msgsize = sizeof(MessageHdr) + sizeof(toaddr->addr) + sizeof(long) + 1;
-    // Add on size of an int plus the number of members in the list
-    msgsize += sizeof(int) + ml.size()*(sizeof(int) + sizeof(short) + sizeof(long));
-    msgsize += 5*sizeof(char[6]);
-    msg = (MessageHdr *) malloc(msgsize * sizeof(char));
-    
-    // create PING message: format of data is
-    createMessageHdr(msg, PING, &memberNode->addr, memberNode->heartbeat, &ptr);
-    
-    // ptr points to the end of the message header so fill data from there
-    // write an int with number of members
-    *ptr = (int) ml.size();
-    ptr += sizeof(int);
-    
-    for (int i = 0; i < ml.size(); i++) {
-        mle = &ml[i];
-        *ptr = (int) mle->getid();
-        ptr += sizeof(int);
-        *ptr = (short) mle->getport();
-        ptr += sizeof(short);
-        *ptr = (long) mle->getheartbeat();
-        ptr += sizeof(long);
-    }
-    
-    //Add the current failed nodes
-    memcpy(ptr, this->failedList.addr, sizeof(char[6]));
-    ptr += sizeof(char[6]);
-    memcpy(ptr, this->failedList1.addr, sizeof(char[6]));
-    ptr += sizeof(char[6]);
-    memcpy(ptr, this->failedList2.addr, sizeof(char[6]));
-    ptr += sizeof(char[6]);
-    memcpy(ptr, this->failedList3.addr, sizeof(char[6]));
-    ptr += sizeof(char[6]);
-    memcpy(ptr, this->failedList4.addr, sizeof(char[6]));
-    ptr += sizeof(char[6]);
+    if (par->VIEW_MODE == FULL_VIEW && par->PIGGYBACK_MAX > 0 && (int) ml.size() > par->PIGGYBACK_MAX) {
+        // Bounded piggybacking: a random sample, anti-entropy fills in the rest
+        vector<int> idx(ml.size());
+        for (int i = 0; i < (int) ml.size(); i++) {
+            idx[i] = i;
+        }
+        for (int i = 0; i < par->PIGGYBACK_MAX; i++) {
+            int j = i + rand() % (idx.size() - i);
+            swap(idx[i], idx[j]);
+            sample.push_back(ml[idx[i]]);
+        }
+        sort(sample.begin(), sample.end(), memberLess);
+        msg.setMembers(FIELD_members, &sample);
+    } else if (par->VIEW_MODE == FULL_VIEW) {
+        // Partial views are never gossiped wholesale; they change through shuffles
+        msg.setMembers(FIELD_members, &store);
+    }
+    msg.setAddrs(FIELD_failed, failed, getFailedList(failed));
+    getLeftList(left);
+    msg.setAddrs(FIELD_left, left.data(), (int) left.size());
+    msg.setUint(FIELD_trace, trace);
     
     cout << "Sending PING: " << memberNode->addr.addr <<" heartbeat: " << memberNode->heartbeat << endl;
 #ifdef DEBUGLOG
@@ -860,15 +2123,11 @@ void MP1Node::sendPING(Address *toaddr, std::vector<MemberListEntry> ml, Address
 #endif
     
     // send PING message to selected peer
-    emulNet->ENsend(&memberNode->addr, toaddr, (char *)msg, msgsize);
+    sendMessage(toaddr, &msg);
+    traceSent(trace, toaddr, 1, PING);
     if (fromme) {
-        /*
-        this->pingList.push_back(*toaddr);
-         */
         this->pingList = *toaddr;
     }
-    
-    free(msg);
 
     return;
 }
@@ -882,34 +2141,21 @@ void MP1Node::sendPING(Address *toaddr, std::vector<MemberListEntry> ml, Address
  *                  memberNode->heartbeat
  *                  FAILED
  *                  failedpeer->addr
+ *                  LEFT
+ *                  departed peers
  */
-void MP1Node::sendPINGREP(Address *toaddr) {
-    MessageHdr *msg;
-    char *ptr;
-
+void MP1Node::sendPINGREP(Address *toaddr, unsigned long trace) {
+    MsgBuilder msg(PINGREP, &memberNode->addr, memberNode->heartbeat);
+    Address failed[5];
+    vector<Address> left;
 #ifdef DEBUGLOG
     static char s[1024];
 #endif
     
-    size_t msgsize = sizeof(MessageHdr) + sizeof(toaddr->addr) + sizeof(long) + 1;
-    msgsize += 5*sizeof(char[6]);
-    msg = (MessageHdr *) malloc(msgsize * sizeof(char));
-    
-    
-    // create PING message: format of data is
-    createMessageHdr(msg, PINGREP, &memberNode->addr, memberNode->heartbeat, &ptr);
-    
-    //Add the current failed nodes
-    memcpy(ptr, this->failedList.addr, sizeof(char[6]));
-    ptr += sizeof(char[6]);
-    memcpy(ptr, this->failedList1.addr, sizeof(char[6]));
-    ptr += sizeof(char[6]);
-    memcpy(ptr, this->failedList2.addr, sizeof(char[6]));
-    ptr += sizeof(char[6]);
-    memcpy(ptr, this->failedList3.addr, sizeof(char[6]));
-    ptr += sizeof(char[6]);
-    memcpy(ptr, this->failedList4.addr, sizeof(char[6]));
-    ptr += sizeof(char[6]);
+    msg.setAddrs(FIELD_failed, failed, getFailedList(failed));
+    getLeftList(left);
+    msg.setAddrs(FIELD_left, left.data(), (int) left.size());
+    msg.setUint(FIELD_trace, trace);
     
     cout << "Sending PINGREP: " << memberNode->addr.addr <<" heartbeat: " << memberNode->heartbeat << endl;
 #ifdef DEBUGLOG
@@ -917,10 +2163,9 @@ void MP1Node::sendPINGREP(Address *toaddr) {
     log->LOG(&memberNode->addr, s);
 #endif
     
-    // send JOINREP message to new peer
-    emulNet->ENsend(&memberNode->addr, toaddr, (char *)msg, msgsize);
-    
-    free(msg);
+    // send PINGREP message to the pinging peer
+    sendMessage(toaddr, &msg);
+    traceSent(trace, toaddr, 1, PINGREP);
     
     return;
 }
@@ -936,41 +2181,17 @@ void MP1Node::sendPINGREP(Address *toaddr) {
  *                  frompeer->addr.addr
  *                  failedpeer->addr
  */
-void MP1Node::sendINDPING(Address *toaddr, Address *pingaddr, Address *fromaddr, Address *faddress) {
-    MessageHdr *msg;
-    char *ptr;
+void MP1Node::sendINDPING(Address *toaddr, Address *pingaddr, Address *fromaddr, Address *faddress, unsigned long trace, int n) {
+    MsgBuilder msg(INDPING, &memberNode->addr, memberNode->heartbeat);
+    Address failed[5];
 #ifdef DEBUGLOG
     static char s[1024];
 #endif
     
-    size_t msgsize = sizeof(MessageHdr) + sizeof(toaddr->addr) + sizeof(long) + sizeof(pingaddr->addr) +
-    sizeof(pingaddr->addr)+ 1;
-    msgsize += 5*sizeof(char[6]);
-    msg = (MessageHdr *) malloc(msgsize * sizeof(char));
-    
-    // create PING message: format of data is
-    createMessageHdr(msg, INDPING, &memberNode->addr, memberNode->heartbeat, &ptr);
-    // ptr points to the end of the header message so start filling data from there.
-    
-    // Add ping address
-    memcpy(ptr, pingaddr->addr, sizeof(char[6]));
-    ptr += sizeof(char[6]);
-    // Add from address
-    memcpy(ptr, fromaddr->addr, sizeof(char[6]));
-    ptr += sizeof(char[6]);
-    
-    //Add the current failed nodes
-    memcpy(ptr, this->failedList.addr, sizeof(char[6]));
-    ptr += sizeof(char[6]);
-    memcpy(ptr, this->failedList1.addr, sizeof(char[6]));
-    ptr += sizeof(char[6]);
-    memcpy(ptr, this->failedList2.addr, sizeof(char[6]));
-    ptr += sizeof(char[6]);
-    memcpy(ptr, this->failedList3.addr, sizeof(char[6]));
-    ptr += sizeof(char[6]);
-    memcpy(ptr, this->failedList4.addr, sizeof(char[6]));
-    ptr += sizeof(char[6]);
-    
+    msg.setAddr(FIELD_target, pingaddr);
+    msg.setAddr(FIELD_origin, fromaddr);
+    msg.setAddrs(FIELD_failed, failed, getFailedList(failed));
+    msg.setUint(FIELD_trace, trace);
     
     cout << "Sending INDPING: " << memberNode->addr.addr <<" heartbeat: " << memberNode->heartbeat << endl;
 #ifdef DEBUGLOG
@@ -978,10 +2199,9 @@ void MP1Node::sendINDPING(Address *toaddr, Address *pingaddr, Address *fromaddr,
     log->LOG(&memberNode->addr, s);
 #endif
     
-    // send INDPING message to selected peer
-    emulNet->ENsend(&memberNode->addr, toaddr, (char *)msg, msgsize);
-    
-    free(msg);
+    // send INDPING message to the selected peers
+    multicastMessage(toaddr, n, &msg);
+    traceSent(trace, toaddr, n, INDPING);
     
     return;
 }
@@ -990,61 +2210,263 @@ void MP1Node::sendINDPING(Address *toaddr, Address *pingaddr, Address *fromaddr,
  * FUNCTION NAME: sendINDPINGREP
  *
  * DESCRIPTION: Send INDPINGREP message.   The message structure is:
- *                  INDPING
+ *                  INDPINGREP
  *                  memberNode->addr.addr
  *                  memberNode->heartbeat
  *                  pingpeer->addr.addr
+ *                  frompeer->addr.addr
  *                  failedpeer->addr
  */
-void MP1Node::sendINDPINGREP(Address *toaddr, Address *pingaddr, Address *fromaddr, Address *faddress) {
-    MessageHdr *msg;
-    char *ptr;
+void MP1Node::sendINDPINGREP(Address *toaddr, Address *pingaddr, Address *fromaddr, Address *faddress, unsigned long trace) {
+    MsgBuilder msg(INDPINGREP, &memberNode->addr, memberNode->heartbeat);
+    Address failed[5];
 #ifdef DEBUGLOG
     static char s[1024];
 #endif
     
-    size_t msgsize = sizeof(MessageHdr) + sizeof(toaddr->addr) + sizeof(long) + sizeof(pingaddr->addr) +
-    sizeof(pingaddr->addr)+ 1;
-    msgsize += 5*sizeof(char[6]);
-    msg = (MessageHdr *) malloc(msgsize * sizeof(char));
+    msg.setAddr(FIELD_target, pingaddr);
+    msg.setAddr(FIELD_origin, fromaddr);
+    msg.setAddrs(FIELD_failed, failed, getFailedList(failed));
+    msg.setUint(FIELD_trace, trace);
     
-    // create PING message: format of data is
-    createMessageHdr(msg, INDPINGREP, &memberNode->addr, memberNode->heartbeat, &ptr);
-    // ptr points to the end of the header message so start filling data from there.
+    cout << "Sending INDPINGREP: " << memberNode->addr.addr <<" heartbeat: " << memberNode->heartbeat << endl;
+#ifdef DEBUGLOG
+    sprintf(s, "Sending indping response...");
+    log->LOG(&memberNode->addr, s);
+#endif
     
-    // Add ping address
-    memcpy(ptr, pingaddr->addr, sizeof(char[6]));
-    ptr += sizeof(char[6]);
-    // Add from address
-    memcpy(ptr, fromaddr->addr, sizeof(char[6]));
-    ptr += sizeof(char[6]);
+    // send INDPINGREP message to selected peer
+    sendMessage(toaddr, &msg);
+    traceSent(trace, toaddr, 1, INDPINGREP);
     
-    //Add the current failed nodes
-    memcpy(ptr, this->failedList.addr, sizeof(char[6]));
-    ptr += sizeof(char[6]);
-    memcpy(ptr, this->failedList1.addr, sizeof(char[6]));
-    ptr += sizeof(char[6]);
-    memcpy(ptr, this->failedList2.addr, sizeof(char[6]));
-    ptr += sizeof(char[6]);
-    memcpy(ptr, this->failedList3.addr, sizeof(char[6]));
-    ptr += sizeof(char[6]);
-    memcpy(ptr, this->failedList4.addr, sizeof(char[6]));
-    ptr += sizeof(char[6]);
+    return;
+}
 
+/**
+ * FUNCTION NAME: sendFORWARDJOIN
+ *
+ * DESCRIPTION: Send FORWARDJOIN message.   The message structure is:
+ *                  FORWARDJOIN
+ *                  memberNode->addr.addr
+ *                  memberNode->heartbeat
+ *                  joinpeer->addr.addr
+ *                  time to live
+ */
+void MP1Node::sendFORWARDJOIN(Address *toaddr, Address *joinaddr, int ttl) {
+    MsgBuilder msg(FORWARDJOIN, &memberNode->addr, memberNode->heartbeat);
     
+    msg.setAddr(FIELD_target, joinaddr);
+    msg.setUint(FIELD_ttl, ttl);
+#ifdef DEBUGLOG
+    log->LOG(&memberNode->addr, "Forwarding join walk (ttl %d)...", ttl);
+#endif
     
-    cout << "Sending INDPINGREP: " << memberNode->addr.addr <<" heartbeat: " << memberNode->heartbeat << endl;
+    sendMessage(toaddr, &msg);
+    
+    return;
+}
+
+/**
+ * FUNCTION NAME: sendNEIGHBOR
+ *
+ * DESCRIPTION: Send NEIGHBOR message asking to join the peer's active view.   The message
+ *              structure is:
+ *                  NEIGHBOR
+ *                  memberNode->addr.addr
+ *                  memberNode->heartbeat
+ *                  priority
+ */
+void MP1Node::sendNEIGHBOR(Address *toaddr, bool priority) {
+    MsgBuilder msg(NEIGHBOR, &memberNode->addr, memberNode->heartbeat);
+    
+    msg.setUint(FIELD_priority, priority ? 1 : 0);
 #ifdef DEBUGLOG
-    sprintf(s, "Sending indping response...");
-    log->LOG(&memberNode->addr, s);
+    log->LOG(&memberNode->addr, "Sending neighbor request...");
 #endif
     
-    // send INDPINGREP message to selected peer
-    emulNet->ENsend(&memberNode->addr, toaddr, (char *)msg, msgsize);
+    sendMessage(toaddr, &msg);
+    
+    return;
+}
+
+/**
+ * FUNCTION NAME: sendNEIGHBORREP
+ *
+ * DESCRIPTION: Send NEIGHBORREP message.   The message structure is:
+ *                  NEIGHBORREP
+ *                  memberNode->addr.addr
+ *                  memberNode->heartbeat
+ *                  accepted
+ */
+void MP1Node::sendNEIGHBORREP(Address *toaddr, bool accept) {
+    MsgBuilder msg(NEIGHBORREP, &memberNode->addr, memberNode->heartbeat);
+    
+    msg.setUint(FIELD_accept, accept ? 1 : 0);
+    
+    sendMessage(toaddr, &msg);
+    
+    return;
+}
+
+/**
+ * FUNCTION NAME: sendDISCONNECT
+ *
+ * DESCRIPTION: Send DISCONNECT message telling a peer it left my active view.   The
+ *              message structure is:
+ *                  DISCONNECT
+ *                  memberNode->addr.addr
+ *                  memberNode->heartbeat
+ */
+void MP1Node::sendDISCONNECT(Address *toaddr) {
+    MsgBuilder msg(DISCONNECT, &memberNode->addr, memberNode->heartbeat);
+    
+    sendMessage(toaddr, &msg);
+    
+    return;
+}
+
+/**
+ * FUNCTION NAME: sendSHUFFLE
+ *
+ * DESCRIPTION: Send SHUFFLE message.   The message structure is:
+ *                  SHUFFLE
+ *                  memberNode->addr.addr
+ *                  memberNode->heartbeat
+ *                  originpeer->addr.addr
+ *                  time to live
+ *                  sample of the origin's views
+ */
+void MP1Node::sendSHUFFLE(Address *toaddr, Address *origin, int ttl, vector<Address> &nodes) {
+    MsgBuilder msg(SHUFFLE, &memberNode->addr, memberNode->heartbeat);
+    
+    msg.setAddr(FIELD_origin, origin);
+    msg.setUint(FIELD_ttl, ttl);
+    msg.setAddrs(FIELD_nodes, nodes.empty() ? NULL : &nodes[0], nodes.size());
     
-    free(msg);
+    sendMessage(toaddr, &msg);
     
     return;
 }
 
+/**
+ * FUNCTION NAME: sendSHUFFLEREP
+ *
+ * DESCRIPTION: Send SHUFFLEREP message.   The message structure is:
+ *                  SHUFFLEREP
+ *                  memberNode->addr.addr
+ *                  memberNode->heartbeat
+ *                  sample of my passive view
+ */
+void MP1Node::sendSHUFFLEREP(Address *toaddr, vector<Address> &nodes) {
+    MsgBuilder msg(SHUFFLEREP, &memberNode->addr, memberNode->heartbeat);
+    
+    msg.setAddrs(FIELD_nodes, nodes.empty() ? NULL : &nodes[0], nodes.size());
+    
+    sendMessage(toaddr, &msg);
+    
+    return;
+}
+
+/**
+ * FUNCTION NAME: sendDIGEST
+ *
+ * DESCRIPTION: Send DIGEST message.   The message structure is:
+ *                  DIGEST
+ *                  memberNode->addr.addr
+ *                  memberNode->heartbeat
+ *                  per bucket hash of memberNode->memberList
+ */
+void MP1Node::sendDIGEST(Address *toaddr) {
+    MsgBuilder msg(DIGEST, &memberNode->addr, memberNode->heartbeat);
+    
+    digest->build(memberNode->memberList);
+    msg.setUints(FIELD_digest, &digest->getHashes()[0], digest->getHashes().size());
+    
+    sendMessage(toaddr, &msg);
+    
+    return;
+}
+
+/**
+ * FUNCTION NAME: sendDIGESTREP
+ *
+ * DESCRIPTION: Send DIGESTREP message.   The message structure is:
+ *                  DIGESTREP
+ *                  memberNode->addr.addr
+ *                  memberNode->heartbeat
+ *                  differing buckets
+ *                  my entries in those buckets
+ */
+void MP1Node::sendDIGESTREP(Address *toaddr, vector<unsigned long> &buckets, vector<MemberListEntry> &ml) {
+    MsgBuilder msg(DIGESTREP, &memberNode->addr, memberNode->heartbeat);
+    
+    msg.setUints(FIELD_buckets, &buckets[0], buckets.size());
+    msg.setMembers(FIELD_members, &ml);
+    
+    sendMessage(toaddr, &msg);
+    
+    return;
+}
 
+/**
+ * FUNCTION NAME: sendDIGESTPUSH
+ *
+ * DESCRIPTION: Send DIGESTPUSH message.   The message structure is:
+ *                  DIGESTPUSH
+ *                  memberNode->addr.addr
+ *                  memberNode->heartbeat
+ *                  my entries in the differing buckets
+ */
+void MP1Node::sendDIGESTPUSH(Address *toaddr, vector<MemberListEntry> &ml) {
+    MsgBuilder msg(DIGESTPUSH, &memberNode->addr, memberNode->heartbeat);
+    
+    msg.setMembers(FIELD_members, &ml);
+    
+    sendMessage(toaddr, &msg);
+    
+    return;
+}
+
+/**
+ * FUNCTION NAME: sendLEAVE
+ *
+ * DESCRIPTION: Send LEAVE message telling n peers I am leaving the group.   The message
+ *              structure is:
+ *                  LEAVE
+ *                  memberNode->addr.addr
+ *                  memberNode->heartbeat
+ */
+void MP1Node::sendLEAVE(Address *toaddrs, int n) {
+    MsgBuilder msg(LEAVE, &memberNode->addr, memberNode->heartbeat);
+    
+    multicastMessage(toaddrs, n, &msg);
+    
+    return;
+}
+
+/**
+ * FUNCTION NAME: sendHEARTBEAT
+ *
+ * DESCRIPTION: Send HEARTBEAT message to n peers, with my whole list for gossip.   The
+ *              message structure is:
+ *                  HEARTBEAT
+ *                  memberNode->addr.addr
+ *                  memberNode->heartbeat
+ *                  memberNode->memberList (gossip only)
+ *                  LEFT
+ *                  departed peers
+ */
+void MP1Node::sendHEARTBEAT(Address *toaddrs, int n, bool withMembers) {
+    MsgBuilder msg(HEARTBEAT, &memberNode->addr, memberNode->heartbeat);
+    vector<Address> left;
+    
+    if (withMembers) {
+        msg.setMembers(FIELD_members, &store);
+    }
+    getLeftList(left);
+    msg.setAddrs(FIELD_left, left.data(), (int) left.size());
+    
+    multicastMessage(toaddrs, n, &msg);
+    
+    return;
+}
@@ -14,6 +14,16 @@
 #include "Member.h"
 #include "EmulNet.h"
 #include "Queue.h"
+#include "ProbeScheduler.h"
+#include "PhiAccrual.h"
+#include "Codec.h"
+#include "PartialView.h"
+#include "ViewDigest.h"
+#include "MemberStore.h"
+#include "ViewSnapshot.h"
+#include "Protocol.h"
+#include "Probes.h"
+#include "Tracer.h"
 
 /**
  * Macros
@@ -21,34 +31,70 @@
 #define TREMOVE 20
 #define TFAIL 5
 #define TIMEOUT 15
+// Times a busy member may pass a join request on before someone must handle it
+#define JOIN_RELAY_HOPS 2
+// Ticks a departure is piggybacked after I first hear of it, and kept as a tombstone
+#define LEAVE_GOSSIP 30
+#define TOMBSTONE_TTL 300
 
 /*
  * Note: You can change/add any functions in MP1Node.{h,cpp}
  */
 
 /**
- * Message Types
+ * STRUCT NAME: PeerRtt
+ *
+ * DESCRIPTION: Smoothed round trip time and its variance for one peer, in ticks,
+ *              estimated from PING->PINGREP round trips (RFC 6298 style)
  */
-enum MsgTypes{
-    JOINREQ,
-    JOINREP,
-    PING,
-    INDPING,
-    PINGREP,
-    INDPINGREP,
-    JOINED,
-    FAILED,
-    DUMMYLASTMSGTYPE
-};
+typedef struct PeerRtt {
+	double srtt;
+	double rttvar;
+}PeerRtt;
+
+/**
+ * STRUCT NAME: OutFrame
+ *
+ * DESCRIPTION: Messages queued for one destination during the current tick
+ */
+typedef struct OutFrame {
+	Address to;
+	MsgBatch batch;
+}OutFrame;
+
+/**
+ * Membership change events delivered to subscribers
+ */
+enum MembershipEventType { EVENT_JOIN, EVENT_SUSPECT, EVENT_FAIL, EVENT_LEAVE };
+
+/**
+ * STRUCT NAME: MembershipEvent
+ *
+ * DESCRIPTION: One change of my membership list.  SUSPECT is raised when a probe goes
+ *              unanswered; a suspect that is not followed by FAIL has answered after all.
+ *              LEAVE means the member left my list without being declared failed.
+ */
+typedef struct MembershipEvent {
+	int type;
+	Address addr;
+	long time;
+}MembershipEvent;
+
+/*
+ * Subscriber callback: gets the view version reached by the batch and the batch itself
+ */
+typedef void (*MembershipCallback)(void *env, long version, const vector<MembershipEvent> &events);
 
 /**
- * STRUCT NAME: MessageHdr
+ * STRUCT NAME: Subscription
  *
- * DESCRIPTION: Header and content of a message
+ * DESCRIPTION: A registered subscriber
  */
-typedef struct MessageHdr {
-	enum MsgTypes msgType;
-}MessageHdr;
+typedef struct Subscription {
+	int id;
+	MembershipCallback callback;
+	void *env;
+}Subscription;
 
 /**
  * CLASS NAME: MP1Node
@@ -69,6 +115,71 @@ private:
     Address failedList3;
     Address failedList4;
     int cntfailed;
+    ProbeScheduler probes;
+    // Lifeguard local health multiplier: grows when I am wrongly declared failed
+    // (and refute it), shrinks on every successful probe
+    int localHealth;
+    // Tick my health last counted a report that I had failed
+    long refutedAt;
+    long pingSentAt;
+    unordered_map<int, PeerRtt> peerRtt;
+    PhiAccrual *phiDetector;
+    map<long, OutFrame> outbox;
+    // Join progress: when I asked to join, which JOINREP fragments have arrived, how many
+    // members the introducer reported and when my own list first reached that size
+    long joinStartTime;
+    long fullViewTime;
+    int joinViewTarget;
+    vector<bool> joinFragments;
+    // Partial-view mode: active/passive views, ticks to the next shuffle and the passive
+    // peer asked to join my active view (with the tick its request expires)
+    PartialView *view;
+    int shuffleCounter;
+    Address neighborPending;
+    long neighborPendingUntil;
+    // Join load: messages and JOINREQs handled this tick, and their totals and peaks
+    int recvThisTick;
+    int joinReqsThisTick;
+    long totalRecv;
+    int peakRecv;
+    int peakJoinReqs;
+    long activeTicks;
+    int joinReqsHandled;
+    int joinReqsForwarded;
+    long joinTime;
+    // JOINREQs sent so far and the tick of the next retransmission
+    int joinAttempts;
+    long joinRetryAt;
+    // Anti-entropy: digest of my list and ticks to the next exchange
+    ViewDigest *digest;
+    int antiEntropyCounter;
+    // Column-wise mirror of my list, updated with it, for the scans and the encoder
+    MemberStore store;
+    // Subscribers, the events of the current tick and the version of the view they produce
+    vector<Subscription> subscribers;
+    int nextSubscription;
+    vector<MembershipEvent> pendingEvents;
+    long viewVersion;
+    // Peers whose phi has passed half the threshold (already reported as suspects)
+    unordered_set<int> phiSuspected;
+    // Snapshot of my list at every view version while readers on other threads are registered
+    SnapshotPublisher snapshots;
+    // Tombstones of peers that left: address key -> tick I first heard of the departure
+    map<long, long> departed;
+    // Failure detection strategy, and the bytes and packets it has cost me
+    Protocol *protocol;
+    long bytesSent;
+    long packetsSent;
+    // Phase timer, NULL unless PROFILE is set
+    TickProfiler *prof;
+    // Probe tracer (NULL unless TRACE_SAMPLE is set) and the trace id of my current probe
+    Tracer *tracer;
+    unsigned long pingTrace;
+    // Probes I started and how they ended
+    long probesStarted;
+    long probesAcked;
+    long probesIndirect;
+    long probesTimedOut;
 
 public:
 	MP1Node(Member *, Params *, EmulNet *, Log *, Address *);
@@ -84,28 +195,105 @@ public:
 	void nodeLoop();
 	void checkMessages();
 	bool recvCallBack(void *env, char *data, int size);
+	bool handleMessage(const char *data, int size);
 	void nodeLoopOps();
+	void swimOps();
+	void getPeers(vector<Address> &peers);
+	void sendHEARTBEAT(Address *toaddrs, int n, bool withMembers);
+	void handleHeartbeat(MsgView *msg);
+	void expireMembers(int timeout);
+	const char *getProtocolName() { return protocol->name(); }
+	long getBytesSent() { return bytesSent; }
+	long getPacketsSent() { return packetsSent; }
+	long getActiveTicks() { return activeTicks; }
+	void setProfiler(TickProfiler *p) { prof = p; }
+	void setTracer(Tracer *t) { tracer = t; }
+	long getProbesStarted() { return probesStarted; }
+	long getProbesAcked() { return probesAcked; }
+	long getProbesIndirect() { return probesIndirect; }
+	long getProbesTimedOut() { return probesTimedOut; }
+	int getRecvLastTick() { return recvThisTick; }
+	int getPeakRecv() { return peakRecv; }
+	int sendIndirectProbes(Address *pingaddr);
+	void updateLocalHealth(int delta);
+	void updatePeerRtt(Address *addr, long rtt);
+	int getProbeTimeout(Address *addr);
+	int getProbePeriod();
+	void checkPhiSuspicion();
 	int isNullAddress(Address *addr);
     int isSameAddress(Address *addr, Address *addr2);
 	Address getJoinAddress();
+	bool randomMember(Address *addr, Address *except);
+	void handleJoinRequest(MsgView *msg);
+	long getJoinStartTime() { return joinStartTime; }
+	long getJoinTime() { return joinTime; }
+	int getJoinAttempts() { return joinAttempts; }
+	void retryJoin();
+	bool joinComplete();
+	int subscribe(MembershipCallback callback, void *env);
+	void unsubscribe(int id);
+	long getViewVersion() { return viewVersion; }
+	SnapshotPublisher *getSnapshots() { return &snapshots; }
+	void raiseEvent(int type, Address *addr);
+	void publishEvents();
+	void reportJoinLoad();
 	void initMemberListTable(Member *memberNode);
     void initPingList();
     void initFailedList();
-    void eraseFromPingList();
+    void eraseFromPingList(const char *outcome);
 	void printAddress(Address *addr);
 	virtual ~MP1Node();
-    void getSenderInfo(char *data, MessageHdr *msgHdr, Address *addr, long *heartbeat, char **endptr);
     void updateMLEFromValues(MemberListEntry *mle, Address *addr, long *heartbeat, long *timestamp);
     void getValuesFromMLE(MemberListEntry *mle, Address *addr, long *heartbeat, long *timestamp);
+    int findMember(Address *addr);
+    bool acceptNewMember(Address *peeraddr);
+    void memberAdded(Address *peeraddr);
+    void notePeerAlive(Address *peeraddr);
+    void refreshMember(MemberListEntry *mle, int row, long heartbeat);
     void addMember(MemberListEntry *peer);
-    void removeMember(Address *peeraddr);
+    void removeMember(Address *peeraddr, int reason = EVENT_FAIL, bool dropped = false);
     void addFailed(Address *addr);
-    void createMessageHdr(MessageHdr *msg, MsgTypes msgtype, Address *addr, long heartbeat, char **endptr);
-    void sendJOINREP(Address *toaddr, std::vector<MemberListEntry> ml);
-    void sendPING(Address *toaddr, std::vector<MemberListEntry> ml, Address *faddress, bool fromme);
-    void sendPINGREP(Address *toaddr);
-    void sendINDPING(Address *toaddr, Address *pingaddr, Address *fromaddr, Address *faddress);
-    void sendINDPINGREP(Address *toaddr, Address *pingaddr, Address *fromaddr, Address *faddress);
+    int isFailed(Address *addr);
+    void addNeighbor(Address *addr, long heartbeat);
+    void dropNeighbor(Address *addr);
+    void partialViewOps();
+    void handleForwardJoin(MsgView *msg);
+    void handleShuffle(MsgView *msg);
+    void integrateShuffle(MsgView *msg);
+    void handleDigest(MsgView *msg);
+    void handleDigestRep(MsgView *msg);
+    void mergeMembers(MsgView *msg);
+    void processFailed(MsgView *msg);
+    void refuteFailed();
+    void bumpHeartbeat();
+    void processLeft(MsgView *msg);
+    void memberLeft(Address *addr);
+    int getLeftList(vector<Address> &list);
+    void expireTombstones();
+    int getFailedList(Address *list);
+    int transmit(Address *toaddr, const char *data, int size);
+    int sendMessage(Address *toaddr, MsgBuilder *msg);
+    int multicastMessage(Address *toaddrs, int n, MsgBuilder *msg);
+    void flushMessages();
+    void sendJOINREQ(Address *toaddr, Address *joinaddr, int hops);
+    void sendJOINREP(Address *toaddr, std::vector<MemberListEntry> &ml);
+    void sendJOINREPFragment(Address *toaddr, std::vector<MemberListEntry> &ml, int fragment, int fragments, int total);
+    void checkFullView();
+    void traceSent(unsigned long trace, Address *toaddrs, int n, MsgTypes type);
+    void sendPING(Address *toaddr, Address *faddress, bool fromme, unsigned long trace);
+    void sendPINGREP(Address *toaddr, unsigned long trace);
+    void sendINDPING(Address *toaddr, Address *pingaddr, Address *fromaddr, Address *faddress, unsigned long trace, int n = 1);
+    void sendINDPINGREP(Address *toaddr, Address *pingaddr, Address *fromaddr, Address *faddress, unsigned long trace);
+    void sendFORWARDJOIN(Address *toaddr, Address *joinaddr, int ttl);
+    void sendNEIGHBOR(Address *toaddr, bool priority);
+    void sendNEIGHBORREP(Address *toaddr, bool accept);
+    void sendDISCONNECT(Address *toaddr);
+    void sendSHUFFLE(Address *toaddr, Address *origin, int ttl, vector<Address> &nodes);
+    void sendSHUFFLEREP(Address *toaddr, vector<Address> &nodes);
+    void sendDIGEST(Address *toaddr);
+    void sendDIGESTREP(Address *toaddr, vector<unsigned long> &buckets, vector<MemberListEntry> &ml);
+    void sendDIGESTPUSH(Address *toaddr, vector<MemberListEntry> &ml);
+    void sendLEAVE(Address *toaddrs, int n);
 };
 
 #endif /* _MP1NODE_H_ */
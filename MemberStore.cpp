@@ -0,0 +1,168 @@
+/**********************************
+ * FILE NAME: MemberStore.cpp
+ *
+ * DESCRIPTION: Column-wise (structure of arrays) mirror of a membership list.
+ * 				Definition of MemberStore class functions.
+ **********************************/
+
+#include "MemberStore.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MEMBERSTORE_AVX2 1
+#endif
+
+/*
+ * Scan kernels.  Each writes the index of every row whose timestamp is below the threshold
+ * into out, in row order, and returns how many it wrote.  out must have room for n + 8
+ * entries: the vector kernel stores whole lanes.
+ */
+static int staleScalar(const int32_t *ts, int n, int32_t threshold, int32_t *out) {
+	int k = 0;
+	for ( int i = 0; i < n; i++ ) {
+		if ( ts[i] < threshold ) {
+			out[k++] = i;
+		}
+	}
+	return k;
+}
+
+#ifdef MEMBERSTORE_AVX2
+// For every 8-bit lane mask, the lane indices of its set bits moved to the front
+static int32_t leftPack[256][8];
+
+static bool initLeftPack() {
+	for ( int mask = 0; mask < 256; mask++ ) {
+		int k = 0;
+		for ( int lane = 0; lane < 8; lane++ ) {
+			if ( mask & (1 << lane) ) {
+				leftPack[mask][k++] = lane;
+			}
+		}
+		while ( k < 8 ) {
+			leftPack[mask][k++] = 0;
+		}
+	}
+	return true;
+}
+static bool leftPackReady = initLeftPack();
+
+__attribute__((target("avx2")))
+static int staleAVX2(const int32_t *ts, int n, int32_t threshold, int32_t *out) {
+	__m256i limit = _mm256_set1_epi32(threshold);
+	__m256i rows = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	__m256i step = _mm256_set1_epi32(8);
+	int i, k = 0;
+
+	for ( i = 0; i + 8 <= n; i += 8 ) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)(ts + i));
+		// lanes with ts < threshold
+		int mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(limit, v)));
+		if ( mask ) {
+			__m256i perm = _mm256_loadu_si256((const __m256i *)leftPack[mask]);
+			_mm256_storeu_si256((__m256i *)(out + k), _mm256_permutevar8x32_epi32(rows, perm));
+			k += __builtin_popcount(mask);
+		}
+		rows = _mm256_add_epi32(rows, step);
+	}
+
+	for ( ; i < n; i++ ) {
+		if ( ts[i] < threshold ) {
+			out[k++] = i;
+		}
+	}
+	return k;
+}
+#endif
+
+/**
+ * FUNCTION NAME: hasAVX2
+ *
+ * DESCRIPTION: True if the scans can use the AVX2 kernel on this CPU
+ */
+bool MemberStore::hasAVX2() {
+#ifdef MEMBERSTORE_AVX2
+	static bool avx2 = __builtin_cpu_supports("avx2");
+	return avx2 && leftPackReady;
+#else
+	return false;
+#endif
+}
+
+/**
+ * FUNCTION NAME: narrow
+ *
+ * DESCRIPTION: A heartbeat or timestamp as a 32-bit value, saturated
+ */
+int32_t MemberStore::narrow(long v) {
+	return (int32_t) max((long) INT32_MIN, min((long) INT32_MAX, v));
+}
+
+/**
+ * FUNCTION NAME: clear
+ *
+ * DESCRIPTION: Drop every row
+ */
+void MemberStore::clear() {
+	ids.clear();
+	ports.clear();
+	heartbeats.clear();
+	timestamps.clear();
+}
+
+/**
+ * FUNCTION NAME: insert
+ *
+ * DESCRIPTION: Add a member as row row, shifting the rows after it
+ */
+void MemberStore::insert(int row, const MemberListEntry &mle) {
+	ids.insert(ids.begin() + row, mle.id);
+	ports.insert(ports.begin() + row, mle.port);
+	heartbeats.insert(heartbeats.begin() + row, narrow(mle.heartbeat));
+	timestamps.insert(timestamps.begin() + row, narrow(mle.timestamp));
+}
+
+/**
+ * FUNCTION NAME: erase
+ *
+ * DESCRIPTION: Remove row row, shifting the rows after it
+ */
+void MemberStore::erase(int row) {
+	ids.erase(ids.begin() + row);
+	ports.erase(ports.begin() + row);
+	heartbeats.erase(heartbeats.begin() + row);
+	timestamps.erase(timestamps.begin() + row);
+}
+
+/**
+ * FUNCTION NAME: update
+ *
+ * DESCRIPTION: Set the heartbeat and timestamp of a row
+ */
+void MemberStore::update(int row, long heartbeat, long timestamp) {
+	heartbeats[row] = narrow(heartbeat);
+	timestamps[row] = narrow(timestamp);
+}
+
+/**
+ * FUNCTION NAME: findStale
+ *
+ * DESCRIPTION: Rows of the members whose timestamp is older than threshold
+ */
+int MemberStore::findStale(long threshold, vector<int32_t> &rows) {
+	int n = timestamps.size();
+	int32_t limit = narrow(threshold);
+	int k;
+
+	rows.resize(n + 8);
+#ifdef MEMBERSTORE_AVX2
+	if ( hasAVX2() ) {
+		k = staleAVX2(n > 0 ? &timestamps[0] : NULL, n, limit, &rows[0]);
+		rows.resize(k);
+		return k;
+	}
+#endif
+	k = staleScalar(n > 0 ? &timestamps[0] : NULL, n, limit, &rows[0]);
+	rows.resize(k);
+	return k;
+}
@@ -0,0 +1,49 @@
+/**********************************
+ * FILE NAME: MemberStore.h
+ *
+ * DESCRIPTION: Column-wise (structure of arrays) mirror of a membership list.
+ * 				Header file of MemberStore class.
+ **********************************/
+
+#ifndef _MEMBERSTORE_H_
+#define _MEMBERSTORE_H_
+
+#include "stdincludes.h"
+#include "Member.h"
+
+/**
+ * CLASS NAME: MemberStore
+ *
+ * DESCRIPTION: Keeps ids, ports, heartbeats and timestamps in separate contiguous arrays,
+ *              row for row in the order of the membership list it mirrors.  The owner
+ *              keeps it in step with every insert(), erase() and update() of the list, so
+ *              it is never rebuilt.  Heartbeats and timestamps are stored as 32-bit values,
+ *              so a timestamp scan reads 4 bytes per member instead of a whole padded
+ *              MemberListEntry.  The scans run 8 members at a time with AVX2 when the CPU
+ *              has it and fall back to a scalar loop otherwise; the message codec encodes
+ *              a MEMBERS field straight from the columns.
+ */
+class MemberStore {
+private:
+	vector<int32_t> ids;
+	vector<int16_t> ports;
+	vector<int32_t> heartbeats;
+	vector<int32_t> timestamps;
+	static int32_t narrow(long v);
+public:
+	MemberStore() {}
+	virtual ~MemberStore() {}
+	void clear();
+	void insert(int row, const MemberListEntry &mle);
+	void erase(int row);
+	void update(int row, long heartbeat, long timestamp);
+	int size() const { return ids.size(); }
+	int getid(int row) const { return ids[row]; }
+	short getport(int row) const { return ports[row]; }
+	long getheartbeat(int row) const { return heartbeats[row]; }
+	long gettimestamp(int row) const { return timestamps[row]; }
+	int findStale(long threshold, vector<int32_t> &rows);
+	static bool hasAVX2();
+};
+
+#endif /* _MEMBERSTORE_H_ */
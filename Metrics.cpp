@@ -0,0 +1,213 @@
+/**********************************
+ * FILE NAME: Metrics.cpp
+ *
+ * DESCRIPTION: Metrics snapshots in the Prometheus text exposition format.
+ * 				Definition of MetricsExporter class functions.
+ **********************************/
+
+#include "Metrics.h"
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <errno.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+/**
+ * Constructor
+ */
+MetricsExporter::MetricsExporter(Params *par): par(par), listenFd(-1) {
+	if ( !par->METRICS_SOCKET.empty() ) {
+		openSocket();
+	}
+}
+
+/**
+ * Destructor
+ */
+MetricsExporter::~MetricsExporter() {
+	if ( listenFd >= 0 ) {
+		close(listenFd);
+		unlink(par->METRICS_SOCKET.c_str());
+	}
+}
+
+/**
+ * FUNCTION NAME: openSocket
+ *
+ * DESCRIPTION: Listen, without blocking, on the METRICS_SOCKET Unix domain socket
+ */
+void MetricsExporter::openSocket() {
+	struct sockaddr_un sa;
+
+	if ( par->METRICS_SOCKET.size() >= sizeof(sa.sun_path) ) {
+		fprintf(stderr, "metrics socket path too long: %s\n", par->METRICS_SOCKET.c_str());
+		return;
+	}
+	memset(&sa, 0, sizeof(sa));
+	sa.sun_family = AF_UNIX;
+	strcpy(sa.sun_path, par->METRICS_SOCKET.c_str());
+
+	listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if ( listenFd < 0 ) {
+		return;
+	}
+	unlink(sa.sun_path);
+	if ( bind(listenFd, (struct sockaddr *) &sa, sizeof(sa)) < 0 || listen(listenFd, 16) < 0 ) {
+		fprintf(stderr, "metrics socket %s: %s\n", sa.sun_path, strerror(errno));
+		close(listenFd);
+		listenFd = -1;
+		return;
+	}
+	fcntl(listenFd, F_SETFL, fcntl(listenFd, F_GETFL) | O_NONBLOCK);
+}
+
+/**
+ * FUNCTION NAME: begin
+ *
+ * DESCRIPTION: Start a new snapshot
+ */
+void MetricsExporter::begin() {
+	building.clear();
+}
+
+/**
+ * FUNCTION NAME: family
+ *
+ * DESCRIPTION: HELP and TYPE lines of a metric family; its samples follow
+ */
+void MetricsExporter::family(const char *name, const char *type, const char *help) {
+	building += "# HELP ";
+	building += name;
+	building += ' ';
+	building += help;
+	building += "\n# TYPE ";
+	building += name;
+	building += ' ';
+	building += type;
+	building += '\n';
+}
+
+/**
+ * FUNCTION NAME: sample
+ *
+ * DESCRIPTION: One sample.  labels is the inside of the braces (e.g. node="3"), or NULL.
+ */
+void MetricsExporter::sample(const char *name, const char *labels, double value) {
+	char buf[64];
+
+	building += name;
+	if ( labels != NULL && labels[0] != 0 ) {
+		building += '{';
+		building += labels;
+		building += '}';
+	}
+	sprintf(buf, " %.15g\n", value);
+	building += buf;
+}
+
+/**
+ * FUNCTION NAME: histogram
+ *
+ * DESCRIPTION: Cumulative buckets with the n upper bounds given (increasing), then +Inf,
+ *              sum and count
+ */
+void MetricsExporter::histogram(const char *name, const char *labels, const vector<long> &values, const double *bounds, int n) {
+	string bucket = string(name) + "_bucket";
+	string le;
+	char buf[64];
+	double sum = 0;
+	long below;
+	int i, b;
+
+	for ( b = 0; b <= n; b++ ) {
+		below = 0;
+		for ( i = 0; i < (int) values.size(); i++ ) {
+			if ( b == n || values[i] <= bounds[b] ) {
+				below++;
+			}
+		}
+		if ( b < n ) {
+			sprintf(buf, "le=\"%g\"", bounds[b]);
+		}
+		else {
+			sprintf(buf, "le=\"+Inf\"");
+		}
+		le = (labels != NULL && labels[0] != 0) ? string(labels) + "," + buf : string(buf);
+		sample(bucket.c_str(), le.c_str(), below);
+	}
+	for ( i = 0; i < (int) values.size(); i++ ) {
+		sum += values[i];
+	}
+	sample((string(name) + "_sum").c_str(), labels, sum);
+	sample((string(name) + "_count").c_str(), labels, values.size());
+}
+
+/**
+ * FUNCTION NAME: allocatorStats
+ *
+ * DESCRIPTION: Heap statistics of the C allocator (glibc only)
+ */
+void MetricsExporter::allocatorStats() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+	struct mallinfo2 mi = mallinfo2();
+
+	family("mp1_heap_bytes", "gauge", "Bytes of the malloc heap by state.");
+	sample("mp1_heap_bytes", "state=\"arena\"", mi.arena);
+	sample("mp1_heap_bytes", "state=\"in_use\"", mi.uordblks);
+	sample("mp1_heap_bytes", "state=\"free\"", mi.fordblks);
+	sample("mp1_heap_bytes", "state=\"mmap\"", mi.hblkhd);
+	family("mp1_heap_mmap_chunks", "gauge", "Chunks allocated with mmap.");
+	sample("mp1_heap_mmap_chunks", NULL, mi.hblks);
+#endif
+}
+
+/**
+ * FUNCTION NAME: publish
+ *
+ * DESCRIPTION: Make the snapshot built since begin() the current one: write it to
+ *              METRICS_FILE atomically and hand it to the socket clients already waiting
+ */
+void MetricsExporter::publish() {
+	string tmp = par->METRICS_FILE + ".tmp";
+	FILE *fp;
+
+	snapshot.swap(building);
+	building.clear();
+
+	if ( !par->METRICS_FILE.empty() ) {
+		fp = fopen(tmp.c_str(), "w");
+		if ( fp != NULL ) {
+			fwrite(snapshot.data(), 1, snapshot.size(), fp);
+			if ( fclose(fp) == 0 ) {
+				rename(tmp.c_str(), par->METRICS_FILE.c_str());
+			}
+		}
+	}
+	serve();
+}
+
+/**
+ * FUNCTION NAME: serve
+ *
+ * DESCRIPTION: Send the current snapshot to every pending connection on the socket
+ */
+void MetricsExporter::serve() {
+	const char *p;
+	ssize_t n;
+	size_t left;
+	int fd;
+
+	if ( listenFd < 0 || snapshot.empty() ) {
+		return;
+	}
+	while ( (fd = accept(listenFd, NULL, NULL)) >= 0 ) {
+		p = snapshot.data();
+		left = snapshot.size();
+		while ( left > 0 && (n = send(fd, p, left, MSG_NOSIGNAL)) > 0 ) {
+			p += n;
+			left -= n;
+		}
+		close(fd);
+	}
+}
@@ -0,0 +1,43 @@
+/**********************************
+ * FILE NAME: Metrics.h
+ *
+ * DESCRIPTION: Metrics snapshots in the Prometheus text exposition format.
+ * 				Header file of MetricsExporter class.
+ **********************************/
+
+#ifndef _METRICS_H_
+#define _METRICS_H_
+
+#include "stdincludes.h"
+#include "Params.h"
+
+/**
+ * CLASS NAME: MetricsExporter
+ *
+ * DESCRIPTION: Builds a snapshot with family()/sample()/histogram() between begin() and
+ *              publish().  publish() writes it to METRICS_FILE through a temporary file
+ *              and rename(), so readers always see a whole snapshot.  If METRICS_SOCKET
+ *              is set the latest snapshot is also served on that Unix domain socket: every
+ *              connection accepted by serve() gets it and is closed.  Both are non-blocking
+ *              for the caller apart from the file write.
+ */
+class MetricsExporter {
+private:
+	Params *par;
+	string building;
+	string snapshot;
+	int listenFd;
+	void openSocket();
+public:
+	MetricsExporter(Params *par);
+	virtual ~MetricsExporter();
+	void begin();
+	void family(const char *name, const char *type, const char *help);
+	void sample(const char *name, const char *labels, double value);
+	void histogram(const char *name, const char *labels, const vector<long> &values, const double *bounds, int n);
+	void allocatorStats();
+	void publish();
+	void serve();
+};
+
+#endif /* _METRICS_H_ */
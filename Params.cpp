@@ -31,6 +31,66 @@ void Params::setparams(char *config_file) {
 	MAX_MSG_SIZE = 4000;
 	globaltime = 0;
 	dropmsg = 0;
+
+	// Optional tuning parameters.  Any further "KEY: value" lines after the
+	// four mandatory ones override these defaults.
+	IND_PING_K = 3;
+	ADAPTIVE_TIMEOUT = 1;
+	LHM_MAX = 8;
+	DETECTOR = SWIM_DETECTOR;
+	PHI_THRESHOLD = 8.0;
+	PHI_WINDOW = 100;
+	PHI_MIN_STDDEV = 0;
+	BATCH_MSGS = 1;
+	JOIN_VIEW = FRAGMENT_JOINVIEW;
+	JOIN_SAMPLE_SIZE = 64;
+	VIEW_MODE = FULL_VIEW;
+	ACTIVE_VIEW_SIZE = 0;
+	PASSIVE_VIEW_SIZE = 0;
+	ACTIVE_RWL = 6;
+	PASSIVE_RWL = 3;
+	SHUFFLE_PERIOD = 10;
+	SHUFFLE_KA = 3;
+	SHUFFLE_KP = 4;
+	SEEDS.clear();
+	JOIN_FORWARD_LOAD = 0;
+	JOIN_RETRY_BASE = 4;
+	JOIN_RETRY_MAX = 64;
+	ANTI_ENTROPY_PERIOD = 0;
+	DIGEST_BUCKETS = 16;
+	PIGGYBACK_MAX = 0;
+	RING_VNODES = 0;
+	GRACEFUL_LEAVE = 0;
+	LEAVE_FANOUT = 3;
+	PROTOCOL = SWIM_PROTOCOL;
+	GOSSIP_FANOUT = 2;
+	HEARTBEAT_TIMEOUT = 20;
+	TRAFFIC_MATRIX = 0;
+	TRAFFIC_MATRIX_PERIOD = 0;
+	TRAFFIC_TOPK = 10;
+	PROFILE = 0;
+	TRACE_SAMPLE = 0;
+	METRICS_PERIOD = 0;
+	METRICS_FILE = "metrics.prom";
+	METRICS_SOCKET = "";
+
+	char key[64];
+	char value[256];
+	while ( fscanf(fp, " %63[^:]: %255s", key, value) == 2 ) {
+		setoption(key, value);
+	}
+
+	// Partial views default to log2(n) + 1 active and six times as many passive peers
+	if ( ACTIVE_VIEW_SIZE <= 0 ) {
+		ACTIVE_VIEW_SIZE = (int) ceil(log2((double) EN_GPSZ)) + 1;
+	}
+	if ( PASSIVE_VIEW_SIZE <= 0 ) {
+		PASSIVE_VIEW_SIZE = 6 * ACTIVE_VIEW_SIZE;
+	}
+	if ( SEEDS.empty() ) {
+		SEEDS.push_back(1);
+	}
+
 	allNodesJoined = 0;
 	for ( unsigned int i = 0; i < EN_GPSZ; i++ ) {
 		allNodesJoined += i;
@@ -39,6 +99,165 @@ void Params::setparams(char *config_file) {
 	return;
 }
 
+/**
+ * FUNCTION NAME: setoption
+ *
+ * DESCRIPTION: Set a single optional parameter from the config file.
+ * 				Unknown keys are ignored.
+ */
+void Params::setoption(const char *key, const char *value) {
+	if ( 0 == strcmp(key, "MAX_MSG_SIZE") ) {
+		MAX_MSG_SIZE = atoi(value);
+	}
+	else if ( 0 == strcmp(key, "STEP_RATE") ) {
+		STEP_RATE = atof(value);
+	}
+	else if ( 0 == strcmp(key, "IND_PING_K") ) {
+		IND_PING_K = atoi(value);
+	}
+	else if ( 0 == strcmp(key, "ADAPTIVE_TIMEOUT") ) {
+		ADAPTIVE_TIMEOUT = atoi(value);
+	}
+	else if ( 0 == strcmp(key, "LHM_MAX") ) {
+		LHM_MAX = atoi(value);
+	}
+	else if ( 0 == strcmp(key, "DETECTOR") ) {
+		DETECTOR = (0 == strcmp(value, "phi")) ? PHI_DETECTOR : SWIM_DETECTOR;
+	}
+	else if ( 0 == strcmp(key, "PHI_THRESHOLD") ) {
+		PHI_THRESHOLD = atof(value);
+	}
+	else if ( 0 == strcmp(key, "PHI_WINDOW") ) {
+		PHI_WINDOW = atoi(value);
+	}
+	else if ( 0 == strcmp(key, "PHI_MIN_STDDEV") ) {
+		PHI_MIN_STDDEV = atof(value);
+	}
+	else if ( 0 == strcmp(key, "BATCH_MSGS") ) {
+		BATCH_MSGS = atoi(value);
+	}
+	else if ( 0 == strcmp(key, "JOIN_VIEW") ) {
+		if ( 0 == strcmp(value, "full") ) {
+			JOIN_VIEW = FULL_JOINVIEW;
+		}
+		else if ( 0 == strcmp(value, "sample") ) {
+			JOIN_VIEW = SAMPLE_JOINVIEW;
+		}
+		else {
+			JOIN_VIEW = FRAGMENT_JOINVIEW;
+		}
+	}
+	else if ( 0 == strcmp(key, "JOIN_SAMPLE_SIZE") ) {
+		JOIN_SAMPLE_SIZE = atoi(value);
+	}
+	else if ( 0 == strcmp(key, "VIEW_MODE") ) {
+		VIEW_MODE = (0 == strcmp(value, "partial")) ? PARTIAL_VIEW : FULL_VIEW;
+	}
+	else if ( 0 == strcmp(key, "ACTIVE_VIEW_SIZE") ) {
+		ACTIVE_VIEW_SIZE = atoi(value);
+	}
+	else if ( 0 == strcmp(key, "PASSIVE_VIEW_SIZE") ) {
+		PASSIVE_VIEW_SIZE = atoi(value);
+	}
+	else if ( 0 == strcmp(key, "ACTIVE_RWL") ) {
+		ACTIVE_RWL = atoi(value);
+	}
+	else if ( 0 == strcmp(key, "PASSIVE_RWL") ) {
+		PASSIVE_RWL = atoi(value);
+	}
+	else if ( 0 == strcmp(key, "SHUFFLE_PERIOD") ) {
+		SHUFFLE_PERIOD = atoi(value);
+	}
+	else if ( 0 == strcmp(key, "SHUFFLE_KA") ) {
+		SHUFFLE_KA = atoi(value);
+	}
+	else if ( 0 == strcmp(key, "SHUFFLE_KP") ) {
+		SHUFFLE_KP = atoi(value);
+	}
+	else if ( 0 == strcmp(key, "SEEDS") ) {
+		// Comma separated node ids, e.g. "SEEDS: 1,2,3"; ids outside the group are skipped
+		char list[256];
+		strncpy(list, value, sizeof(list) - 1);
+		list[sizeof(list) - 1] = 0;
+		SEEDS.clear();
+		for ( char *tok = strtok(list, ","); tok != NULL; tok = strtok(NULL, ",") ) {
+			int id = atoi(tok);
+			if ( id >= 1 && id <= EN_GPSZ ) {
+				SEEDS.push_back(id);
+			}
+		}
+	}
+	else if ( 0 == strcmp(key, "JOIN_FORWARD_LOAD") ) {
+		JOIN_FORWARD_LOAD = atoi(value);
+	}
+	else if ( 0 == strcmp(key, "JOIN_RETRY_BASE") ) {
+		JOIN_RETRY_BASE = atoi(value);
+	}
+	else if ( 0 == strcmp(key, "JOIN_RETRY_MAX") ) {
+		JOIN_RETRY_MAX = atoi(value);
+	}
+	else if ( 0 == strcmp(key, "ANTI_ENTROPY_PERIOD") ) {
+		ANTI_ENTROPY_PERIOD = atoi(value);
+	}
+	else if ( 0 == strcmp(key, "DIGEST_BUCKETS") ) {
+		DIGEST_BUCKETS = atoi(value);
+	}
+	else if ( 0 == strcmp(key, "PIGGYBACK_MAX") ) {
+		PIGGYBACK_MAX = atoi(value);
+	}
+	else if ( 0 == strcmp(key, "RING_VNODES") ) {
+		RING_VNODES = atoi(value);
+	}
+	else if ( 0 == strcmp(key, "GRACEFUL_LEAVE") ) {
+		GRACEFUL_LEAVE = atoi(value);
+	}
+	else if ( 0 == strcmp(key, "LEAVE_FANOUT") ) {
+		LEAVE_FANOUT = atoi(value);
+	}
+	else if ( 0 == strcmp(key, "PROTOCOL") ) {
+		if ( 0 == strcmp(value, "alltoall") ) {
+			PROTOCOL = ALLTOALL_PROTOCOL;
+		}
+		else if ( 0 == strcmp(value, "gossip") ) {
+			PROTOCOL = GOSSIP_PROTOCOL;
+		}
+		else {
+			PROTOCOL = SWIM_PROTOCOL;
+		}
+	}
+	else if ( 0 == strcmp(key, "GOSSIP_FANOUT") ) {
+		GOSSIP_FANOUT = atoi(value);
+	}
+	else if ( 0 == strcmp(key, "HEARTBEAT_TIMEOUT") ) {
+		HEARTBEAT_TIMEOUT = atoi(value);
+	}
+	else if ( 0 == strcmp(key, "TRAFFIC_MATRIX") ) {
+		TRAFFIC_MATRIX = atoi(value);
+	}
+	else if ( 0 == strcmp(key, "TRAFFIC_MATRIX_PERIOD") ) {
+		TRAFFIC_MATRIX_PERIOD = atoi(value);
+	}
+	else if ( 0 == strcmp(key, "TRAFFIC_TOPK") ) {
+		TRAFFIC_TOPK = atoi(value);
+	}
+	else if ( 0 == strcmp(key, "PROFILE") ) {
+		PROFILE = atoi(value);
+	}
+	else if ( 0 == strcmp(key, "TRACE_SAMPLE") ) {
+		TRACE_SAMPLE = atoi(value);
+	}
+	else if ( 0 == strcmp(key, "METRICS_PERIOD") ) {
+		METRICS_PERIOD = atoi(value);
+	}
+	else if ( 0 == strcmp(key, "METRICS_FILE") ) {
+		// "none" for no file
+		METRICS_FILE = (0 == strcmp(value, "none")) ? "" : value;
+	}
+	else if ( 0 == strcmp(key, "METRICS_SOCKET") ) {
+		METRICS_SOCKET = value;
+	}
+}
+
 /**
  * FUNCTION NAME: getcurrtime
  *
@@ -12,6 +12,10 @@
 #include "Member.h"
 
 enum testTYPE { CREATE_TEST, READ_TEST, UPDATE_TEST, DELETE_TEST };
+enum detectorTYPE { SWIM_DETECTOR, PHI_DETECTOR };
+enum joinviewTYPE { FULL_JOINVIEW, FRAGMENT_JOINVIEW, SAMPLE_JOINVIEW };
+enum viewTYPE { FULL_VIEW, PARTIAL_VIEW };
+enum protocolTYPE { SWIM_PROTOCOL, ALLTOALL_PROTOCOL, GOSSIP_PROTOCOL };
 
 /**
  * CLASS NAME: Params
@@ -31,8 +35,48 @@ public:
 	int globaltime;
 	int allNodesJoined;
 	short PORTNUM;
+	int IND_PING_K;             // number of parallel indirect probes per ping timeout
+	int ADAPTIVE_TIMEOUT;       // scale probe timeouts by local health and per-peer RTT
+	int LHM_MAX;                // upper bound of the local health multiplier
+	int DETECTOR;               // detectorTYPE: ack/timeout (swim) or phi accrual (phi)
+	double PHI_THRESHOLD;       // suspicion level at which a peer is declared failed
+	int PHI_WINDOW;             // heartbeat inter-arrival samples kept per peer
+	double PHI_MIN_STDDEV;      // floor on the inter-arrival standard deviation, in ticks (0: twice the probe period)
+	int BATCH_MSGS;             // coalesce all messages to the same peer within a tick
+	int JOIN_VIEW;              // joinviewTYPE: how the introducer ships its list in JOINREP
+	int JOIN_SAMPLE_SIZE;       // entries sent in sample mode
+	int VIEW_MODE;              // viewTYPE: every node knows every member (full) or HyParView views (partial)
+	int ACTIVE_VIEW_SIZE;       // peers probed and gossiped with in partial mode
+	int PASSIVE_VIEW_SIZE;      // reserve of peers used to repair the active view
+	int ACTIVE_RWL;             // hops a FORWARDJOIN walks before the joiner is taken into an active view
+	int PASSIVE_RWL;            // hop at which a FORWARDJOIN leaves the joiner in a passive view
+	int SHUFFLE_PERIOD;         // ticks between passive view shuffles
+	int SHUFFLE_KA;             // active peers sent in a shuffle
+	int SHUFFLE_KP;             // passive peers sent in a shuffle
+	vector<int> SEEDS;          // ids of the nodes joiners contact; the first one boots the group
+	int JOIN_FORWARD_LOAD;      // JOINREQs handled per tick before the rest are forwarded (0 = never)
+	int JOIN_RETRY_BASE;        // ticks before the first JOINREQ retransmission
+	int JOIN_RETRY_MAX;         // cap on the JOINREQ retransmission backoff, in ticks
+	int ANTI_ENTROPY_PERIOD;    // ticks between digest exchanges with a random member (0 = off)
+	int DIGEST_BUCKETS;         // node id ranges hashed separately in a digest
+	int PIGGYBACK_MAX;          // member entries carried by a PING (0 = the whole list)
+	int RING_VNODES;            // points per member on each node's consistent-hash ring (0 = no ring)
+	int GRACEFUL_LEAVE;         // failing nodes leave the group (LEAVE) instead of crashing
+	int LEAVE_FANOUT;           // peers a leaving node sends its LEAVE to
+	int PROTOCOL;               // protocolTYPE: swim, alltoall or gossip heartbeating
+	int GOSSIP_FANOUT;          // members a gossip node sends its list to every tick
+	int HEARTBEAT_TIMEOUT;      // ticks without a newer heartbeat before alltoall/gossip remove a member
+	int TRAFFIC_MATRIX;         // keep per (src, dst) traffic counters and dump the heaviest links
+	int TRAFFIC_MATRIX_PERIOD;  // ticks between dumps of the links of the last period (0 = only at the end)
+	int TRAFFIC_TOPK;           // links listed per dump
+	int PROFILE;                // time the phases of every tick per node (profile.log, profile.folded)
+	int TRACE_SAMPLE;           // trace one in this many probes of each node to trace.json (0 = off)
+	int METRICS_PERIOD;         // ticks between Prometheus metrics snapshots (0 = off)
+	string METRICS_FILE;        // file the snapshots are written to, by rename (empty = none)
+	string METRICS_SOCKET;      // Unix domain socket serving the latest snapshot (empty = none)
 	Params();
 	void setparams(char *);
+	void setoption(const char *key, const char *value);
 	int getcurrtime();
 };
 
@@ -0,0 +1,215 @@
+/**********************************
+ * FILE NAME: PartialView.cpp
+ *
+ * DESCRIPTION: Active and passive partial views of the membership (HyParView).
+ * 				Definition of PartialView class functions.
+ **********************************/
+
+#include "PartialView.h"
+
+/**
+ * Constructor
+ */
+PartialView::PartialView(int activeSize, int passiveSize): activeSize(activeSize), passiveSize(passiveSize) {}
+
+/**
+ * FUNCTION NAME: find
+ *
+ * DESCRIPTION: Index of addr in the view, or -1
+ */
+int PartialView::find(vector<Address> &view, Address *addr) {
+	for ( int i = 0; i < (int) view.size(); i++ ) {
+		if ( view[i] == *addr ) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+/**
+ * FUNCTION NAME: pick
+ *
+ * DESCRIPTION: Random entry of the view other than except (which may be NULL)
+ */
+bool PartialView::pick(vector<Address> &view, Address *addr, Address *except) {
+	int skip = except ? find(view, except) : -1;
+	int n = view.size() - (skip >= 0 ? 1 : 0);
+	int i;
+
+	if ( n <= 0 ) {
+		return false;
+	}
+	i = rand() % n;
+	if ( skip >= 0 && i >= skip ) {
+		i++;
+	}
+	*addr = view[i];
+	return true;
+}
+
+/**
+ * FUNCTION NAME: isActive
+ *
+ * DESCRIPTION: True if addr is in the active view
+ */
+bool PartialView::isActive(Address *addr) {
+	return find(active, addr) >= 0;
+}
+
+/**
+ * FUNCTION NAME: isPassive
+ *
+ * DESCRIPTION: True if addr is in the passive view
+ */
+bool PartialView::isPassive(Address *addr) {
+	return find(passive, addr) >= 0;
+}
+
+/**
+ * FUNCTION NAME: activeFull
+ *
+ * DESCRIPTION: True if the active view cannot take another peer without evicting one
+ */
+bool PartialView::activeFull() {
+	return (int) active.size() >= activeSize;
+}
+
+/**
+ * FUNCTION NAME: activeCount
+ *
+ * DESCRIPTION: getter
+ */
+int PartialView::activeCount() {
+	return active.size();
+}
+
+/**
+ * FUNCTION NAME: passiveCount
+ *
+ * DESCRIPTION: getter
+ */
+int PartialView::passiveCount() {
+	return passive.size();
+}
+
+/**
+ * FUNCTION NAME: addActive
+ *
+ * DESCRIPTION: Move addr into the active view.  If the view is full a random peer is
+ *              evicted into the passive view and returned through evicted.
+ *
+ * RETURNS:
+ * true if a peer was evicted
+ */
+bool PartialView::addActive(Address *addr, Address *evicted) {
+	bool evict = false;
+	int i;
+
+	if ( isActive(addr) ) {
+		return false;
+	}
+	removePassive(addr);
+
+	if ( activeFull() && !active.empty() ) {
+		i = rand() % active.size();
+		*evicted = active[i];
+		active[i] = active.back();
+		active.pop_back();
+		addPassive(evicted);
+		evict = true;
+	}
+	active.push_back(*addr);
+	return evict;
+}
+
+/**
+ * FUNCTION NAME: addPassive
+ *
+ * DESCRIPTION: Remember addr in the passive view unless it is already known, replacing a
+ *              random entry if the view is full.
+ */
+void PartialView::addPassive(Address *addr) {
+	if ( isActive(addr) || isPassive(addr) || passiveSize <= 0 ) {
+		return;
+	}
+	if ( (int) passive.size() >= passiveSize ) {
+		passive[rand() % passive.size()] = *addr;
+	}
+	else {
+		passive.push_back(*addr);
+	}
+}
+
+/**
+ * FUNCTION NAME: removeActive
+ *
+ * DESCRIPTION: Drop addr from the active view
+ */
+void PartialView::removeActive(Address *addr) {
+	int i = find(active, addr);
+	if ( i >= 0 ) {
+		active[i] = active.back();
+		active.pop_back();
+	}
+}
+
+/**
+ * FUNCTION NAME: removePassive
+ *
+ * DESCRIPTION: Drop addr from the passive view
+ */
+void PartialView::removePassive(Address *addr) {
+	int i = find(passive, addr);
+	if ( i >= 0 ) {
+		passive[i] = passive.back();
+		passive.pop_back();
+	}
+}
+
+/**
+ * FUNCTION NAME: randomActive
+ *
+ * DESCRIPTION: Random active peer other than except
+ */
+bool PartialView::randomActive(Address *addr, Address *except) {
+	return pick(active, addr, except);
+}
+
+/**
+ * FUNCTION NAME: randomPassive
+ *
+ * DESCRIPTION: Random passive peer
+ */
+bool PartialView::randomPassive(Address *addr) {
+	return pick(passive, addr, NULL);
+}
+
+/**
+ * FUNCTION NAME: sample
+ *
+ * DESCRIPTION: Append up to ka random active and kp random passive peers to out
+ */
+void PartialView::sample(vector<Address> &out, int ka, int kp) {
+	vector<Address> *views[2] = { &active, &passive };
+	int counts[2] = { ka, kp };
+	int v, i, j;
+
+	for ( v = 0; v < 2; v++ ) {
+		vector<Address> copy(*views[v]);
+		for ( i = 0; i < counts[v] && i < (int) copy.size(); i++ ) {
+			j = i + rand() % (copy.size() - i);
+			swap(copy[i], copy[j]);
+			out.push_back(copy[i]);
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: clear
+ *
+ * DESCRIPTION: Forget both views
+ */
+void PartialView::clear() {
+	active.clear();
+	passive.clear();
+}
@@ -0,0 +1,48 @@
+/**********************************
+ * FILE NAME: PartialView.h
+ *
+ * DESCRIPTION: Active and passive partial views of the membership (HyParView).
+ * 				Header file of PartialView class.
+ **********************************/
+
+#ifndef _PARTIALVIEW_H_
+#define _PARTIALVIEW_H_
+
+#include "stdincludes.h"
+#include "Member.h"
+
+/**
+ * CLASS NAME: PartialView
+ *
+ * DESCRIPTION: Bookkeeping of a HyParView node.  The small active view holds the peers
+ *              this node probes and talks to; the larger passive view is a reserve of
+ *              addresses refreshed by shuffles and used to repair the active view.
+ *              A peer is never in both views.  The networking side lives in MP1Node.
+ */
+class PartialView {
+private:
+	vector<Address> active;
+	vector<Address> passive;
+	int activeSize;
+	int passiveSize;
+	static int find(vector<Address> &view, Address *addr);
+	static bool pick(vector<Address> &view, Address *addr, Address *except);
+public:
+	PartialView(int activeSize, int passiveSize);
+	virtual ~PartialView() {}
+	bool isActive(Address *addr);
+	bool isPassive(Address *addr);
+	bool activeFull();
+	int activeCount();
+	int passiveCount();
+	bool addActive(Address *addr, Address *evicted);
+	void addPassive(Address *addr);
+	void removeActive(Address *addr);
+	void removePassive(Address *addr);
+	bool randomActive(Address *addr, Address *except);
+	bool randomPassive(Address *addr);
+	void sample(vector<Address> &out, int ka, int kp);
+	void clear();
+};
+
+#endif /* _PARTIALVIEW_H_ */
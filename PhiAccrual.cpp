@@ -0,0 +1,122 @@
+/**********************************
+ * FILE NAME: PhiAccrual.cpp
+ *
+ * DESCRIPTION: Phi accrual failure detector.
+ * 				Definition of PhiAccrual class functions.
+ **********************************/
+
+#include "PhiAccrual.h"
+
+/**
+ * Constructor
+ *
+ * firstInterval seeds the window of a newly seen peer so that it is not suspected
+ * before a real interval has been observed.
+ */
+PhiAccrual::PhiAccrual(int windowSize, double minStdDev, double firstInterval):
+	windowSize(windowSize), minStdDev(minStdDev), firstInterval(firstInterval) {}
+
+/**
+ * FUNCTION NAME: setScale
+ *
+ * DESCRIPTION: Change the seed interval of new peers and the standard deviation floor,
+ *              e.g. when the probe period they derive from changes
+ */
+void PhiAccrual::setScale(double firstInterval, double minStdDev) {
+	this->firstInterval = firstInterval;
+	this->minStdDev = minStdDev;
+}
+
+/**
+ * FUNCTION NAME: heartbeat
+ *
+ * DESCRIPTION: Record a fresh heartbeat from the peer at time now
+ */
+void PhiAccrual::heartbeat(int id, long now) {
+	unordered_map<int, ArrivalWindow>::iterator it = windows.find(id);
+	double interval;
+
+	if ( it == windows.end() ) {
+		ArrivalWindow w;
+		w.sum = firstInterval;
+		w.sumsq = firstInterval * firstInterval;
+		w.intervals.push_back(firstInterval);
+		w.last = now;
+		windows[id] = w;
+		return;
+	}
+
+	ArrivalWindow &w = it->second;
+	interval = now - w.last;
+	w.last = now;
+	if ( interval <= 0 ) {
+		return;
+	}
+
+	w.intervals.push_back(interval);
+	w.sum += interval;
+	w.sumsq += interval * interval;
+	if ( (int) w.intervals.size() > windowSize ) {
+		w.sum -= w.intervals.front();
+		w.sumsq -= w.intervals.front() * w.intervals.front();
+		w.intervals.pop_front();
+	}
+}
+
+/**
+ * FUNCTION NAME: phi
+ *
+ * DESCRIPTION: Suspicion level for the peer at time now.  Uses the logistic approximation
+ *              of the normal CDF, which stays finite far out in the tail.
+ *
+ * RETURNS:
+ * 0 for peers that have never been heard from
+ */
+double PhiAccrual::phi(int id, long now) {
+	unordered_map<int, ArrivalWindow>::iterator it = windows.find(id);
+	double n, mean, variance, stddev, y, e;
+
+	if ( it == windows.end() ) {
+		return 0;
+	}
+
+	ArrivalWindow &w = it->second;
+	n = w.intervals.size();
+	mean = w.sum / n;
+	variance = max(0.0, w.sumsq / n - mean * mean);
+	stddev = max(minStdDev, sqrt(variance));
+
+	y = (now - w.last - mean) / stddev;
+	e = exp(-y * (1.5976 + 0.070566 * y * y));
+	if ( now - w.last > mean ) {
+		return -log10(e / (1.0 + e));
+	}
+	return -log10(1.0 - 1.0 / (1.0 + e));
+}
+
+/**
+ * FUNCTION NAME: isTracked
+ *
+ * DESCRIPTION: True if a heartbeat has been recorded for the peer
+ */
+bool PhiAccrual::isTracked(int id) {
+	return windows.count(id) > 0;
+}
+
+/**
+ * FUNCTION NAME: remove
+ *
+ * DESCRIPTION: Forget the peer's history
+ */
+void PhiAccrual::remove(int id) {
+	windows.erase(id);
+}
+
+/**
+ * FUNCTION NAME: clear
+ *
+ * DESCRIPTION: Forget all peers
+ */
+void PhiAccrual::clear() {
+	windows.clear();
+}
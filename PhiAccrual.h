@@ -0,0 +1,50 @@
+/**********************************
+ * FILE NAME: PhiAccrual.h
+ *
+ * DESCRIPTION: Phi accrual failure detector.
+ * 				Header file of PhiAccrual class.
+ **********************************/
+
+#ifndef _PHIACCRUAL_H_
+#define _PHIACCRUAL_H_
+
+#include "stdincludes.h"
+
+/**
+ * STRUCT NAME: ArrivalWindow
+ *
+ * DESCRIPTION: Sliding window of heartbeat inter-arrival times for one peer.  The running
+ *              sum and sum of squares let mean and variance be read in O(1).
+ */
+typedef struct ArrivalWindow {
+	deque<double> intervals;
+	double sum;
+	double sumsq;
+	long last;
+}ArrivalWindow;
+
+/**
+ * CLASS NAME: PhiAccrual
+ *
+ * DESCRIPTION: Keeps a window of heartbeat inter-arrival times per peer and turns the time
+ *              since the last heartbeat into a suspicion level phi = -log10(P(later arrival)),
+ *              assuming normally distributed intervals (Hayashibara et al.).
+ */
+class PhiAccrual {
+private:
+	unordered_map<int, ArrivalWindow> windows;
+	int windowSize;
+	double minStdDev;
+	double firstInterval;
+public:
+	PhiAccrual(int windowSize, double minStdDev, double firstInterval);
+	virtual ~PhiAccrual() {}
+	void setScale(double firstInterval, double minStdDev);
+	void heartbeat(int id, long now);
+	double phi(int id, long now);
+	bool isTracked(int id);
+	void remove(int id);
+	void clear();
+};
+
+#endif /* _PHIACCRUAL_H_ */
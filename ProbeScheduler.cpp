@@ -0,0 +1,130 @@
+/**********************************
+ * FILE NAME: ProbeScheduler.cpp
+ *
+ * DESCRIPTION: Randomized round-robin selection of ping targets.
+ * 				Definition of ProbeScheduler class functions.
+ **********************************/
+
+#include "ProbeScheduler.h"
+
+/**
+ * FUNCTION NAME: place
+ *
+ * DESCRIPTION: Store addr at index i of the permutation and record its position.
+ */
+void ProbeScheduler::place(int i, Address &addr) {
+	order[i] = addr;
+	pos[*(int *)(addr.addr)] = i;
+}
+
+/**
+ * FUNCTION NAME: add
+ *
+ * DESCRIPTION: Insert a new peer at a random position among the peers still pending in
+ *              this pass, so it is probed before the next reshuffle.  O(1).
+ */
+void ProbeScheduler::add(Address *addr) {
+	int id = *(int *)(addr->addr);
+	int i;
+
+	if ( pos.count(id) ) {
+		return;
+	}
+
+	order.push_back(*addr);
+	pos[id] = order.size() - 1;
+
+	// Swap with a random pending slot in [next, size)
+	i = next + rand() % (order.size() - next);
+	if ( i != (int) order.size() - 1 ) {
+		Address displaced = order[i];
+		place(order.size() - 1, displaced);
+		place(i, *addr);
+	}
+}
+
+/**
+ * FUNCTION NAME: remove
+ *
+ * DESCRIPTION: Remove a peer from the permutation in O(1).  If the peer was already
+ *              probed this pass, the last probed peer fills its slot first so that the
+ *              pending section stays intact.
+ */
+void ProbeScheduler::remove(Address *addr) {
+	int id = *(int *)(addr->addr);
+	int i, last;
+	unordered_map<int, int>::iterator it = pos.find(id);
+
+	if ( it == pos.end() ) {
+		return;
+	}
+
+	i = it->second;
+	pos.erase(it);
+
+	if ( i < next ) {
+		// Move the last probed peer into the hole, leaving the hole at next-1
+		next--;
+		if ( i != next ) {
+			Address moved = order[next];
+			place(i, moved);
+		}
+		i = next;
+	}
+
+	last = order.size() - 1;
+	if ( i != last ) {
+		Address moved = order[last];
+		place(i, moved);
+	}
+	order.pop_back();
+}
+
+/**
+ * FUNCTION NAME: nextTarget
+ *
+ * DESCRIPTION: Return the next peer to probe, reshuffling when a pass completes.
+ *
+ * RETURNS:
+ * false if there is no peer to probe
+ */
+bool ProbeScheduler::nextTarget(Address *addr) {
+	int i, j;
+
+	if ( order.empty() ) {
+		return false;
+	}
+
+	if ( next >= (int) order.size() ) {
+		for ( i = order.size() - 1; i > 0; i-- ) {
+			j = rand() % (i + 1);
+			Address tmp = order[i];
+			place(i, order[j]);
+			place(j, tmp);
+		}
+		next = 0;
+	}
+
+	*addr = order[next++];
+	return true;
+}
+
+/**
+ * FUNCTION NAME: size
+ *
+ * DESCRIPTION: Number of peers in the permutation
+ */
+int ProbeScheduler::size() {
+	return order.size();
+}
+
+/**
+ * FUNCTION NAME: clear
+ *
+ * DESCRIPTION: Forget all peers
+ */
+void ProbeScheduler::clear() {
+	order.clear();
+	pos.clear();
+	next = 0;
+}
@@ -0,0 +1,38 @@
+/**********************************
+ * FILE NAME: ProbeScheduler.h
+ *
+ * DESCRIPTION: Randomized round-robin selection of ping targets.
+ * 				Header file of ProbeScheduler class.
+ **********************************/
+
+#ifndef _PROBESCHEDULER_H_
+#define _PROBESCHEDULER_H_
+
+#include "stdincludes.h"
+#include "Member.h"
+
+/**
+ * CLASS NAME: ProbeScheduler
+ *
+ * DESCRIPTION: Walks a random permutation of the known peers, reshuffling at the end of
+ *              each pass, so every peer is probed exactly once per pass (SWIM's
+ *              time-bounded completeness).  Entries before 'next' have been probed in
+ *              the current pass, entries from 'next' onwards are still pending.
+ */
+class ProbeScheduler {
+private:
+	vector<Address> order;
+	unordered_map<int, int> pos;
+	int next;
+	void place(int i, Address &addr);
+public:
+	ProbeScheduler(): next(0) {}
+	virtual ~ProbeScheduler() {}
+	void add(Address *addr);
+	void remove(Address *addr);
+	bool nextTarget(Address *addr);
+	int size();
+	void clear();
+};
+
+#endif /* _PROBESCHEDULER_H_ */
@@ -0,0 +1,48 @@
+/**********************************
+ * FILE NAME: Probes.h
+ *
+ * DESCRIPTION: Static tracepoints (USDT) of the protocol and the emulated network
+ **********************************/
+
+#ifndef _PROBES_H_
+#define _PROBES_H_
+
+/*
+ * The probes are those of <sys/sdt.h> under the provider "mp1": a nop and an ELF note
+ * each, so they cost nothing until bpftrace or perf attaches to them, e.g.
+ *
+ *     bpftrace -e 'usdt:./Application:mp1:probe_timeout { @[arg0] = count(); }'
+ *     perf probe -x ./Application sdt_mp1:en_drop
+ *
+ * Without the header (systemtap-sdt-dev), or built with -DNO_USDT, they compile to nothing.
+ *
+ * Probe                    Arguments
+ * en_send                  src id, dst id, size, type byte (BATCH_FRAME for a batch)
+ * en_drop                  src id, dst id, size, TrafficOutcome
+ * en_recv                  dst id, src id, size
+ * msg_dispatch             node id, message type, size
+ * probe_start              node id, target id, timeout in ticks
+ * probe_indirect           node id, target id, proxies sent an INDPING
+ * probe_timeout            node id, target id
+ * member_add               node id, member id, heartbeat
+ * member_remove            node id, member id, EventType
+ * failed_add               node id, failed id
+ */
+#if !defined(NO_USDT) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#define HAVE_USDT 1
+#endif
+#endif
+
+#ifdef HAVE_USDT
+#include <sys/sdt.h>
+#define MP1_PROBE2(name, a, b) DTRACE_PROBE2(mp1, name, a, b)
+#define MP1_PROBE3(name, a, b, c) DTRACE_PROBE3(mp1, name, a, b, c)
+#define MP1_PROBE4(name, a, b, c, d) DTRACE_PROBE4(mp1, name, a, b, c, d)
+#else
+#define MP1_PROBE2(name, a, b) ((void) 0)
+#define MP1_PROBE3(name, a, b, c) ((void) 0)
+#define MP1_PROBE4(name, a, b, c, d) ((void) 0)
+#endif
+
+#endif /* _PROBES_H_ */
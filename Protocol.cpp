@@ -0,0 +1,91 @@
+/**********************************
+ * FILE NAME: Protocol.cpp
+ *
+ * DESCRIPTION: Failure detection strategies run by a node.
+ * 				Definition of Protocol class functions.
+ **********************************/
+
+#include "Protocol.h"
+#include "MP1Node.h"
+
+/**
+ * FUNCTION NAME: create
+ *
+ * DESCRIPTION: Strategy selected by PROTOCOL
+ */
+Protocol *Protocol::create(Params *par) {
+	if ( par->PROTOCOL == ALLTOALL_PROTOCOL ) {
+		return new AllToAllProtocol(par);
+	}
+	if ( par->PROTOCOL == GOSSIP_PROTOCOL ) {
+		return new GossipProtocol(par);
+	}
+	return new SwimProtocol();
+}
+
+/**
+ * FUNCTION NAME: SwimProtocol::tick
+ *
+ * DESCRIPTION: One probe period step
+ */
+void SwimProtocol::tick(MP1Node *node) {
+	node->swimOps();
+}
+
+/**
+ * FUNCTION NAME: AllToAllProtocol::tick
+ *
+ * DESCRIPTION: Heartbeat every member, then drop the silent ones
+ */
+void AllToAllProtocol::tick(MP1Node *node) {
+	vector<Address> peers;
+
+	node->getPeers(peers);
+	node->sendHEARTBEAT(peers.data(), (int) peers.size(), false);
+	node->expireMembers(par->HEARTBEAT_TIMEOUT);
+}
+
+/**
+ * FUNCTION NAME: AllToAllProtocol::handle
+ *
+ * DESCRIPTION: Take HEARTBEATs
+ */
+bool AllToAllProtocol::handle(MP1Node *node, MsgView *msg) {
+	if ( msg->getType() != HEARTBEAT ) {
+		return false;
+	}
+	node->handleHeartbeat(msg);
+	return true;
+}
+
+/**
+ * FUNCTION NAME: GossipProtocol::tick
+ *
+ * DESCRIPTION: Send my list to GOSSIP_FANOUT distinct random members, then drop the
+ *              silent ones
+ */
+void GossipProtocol::tick(MP1Node *node) {
+	vector<Address> peers;
+	int i, j;
+
+	node->getPeers(peers);
+	for ( i = 0; i < par->GOSSIP_FANOUT && i < (int) peers.size(); i++ ) {
+		j = i + rand() % (peers.size() - i);
+		swap(peers[i], peers[j]);
+	}
+	node->sendHEARTBEAT(peers.data(), i, true);
+	node->expireMembers(par->HEARTBEAT_TIMEOUT);
+}
+
+/**
+ * FUNCTION NAME: GossipProtocol::handle
+ *
+ * DESCRIPTION: Take HEARTBEATs
+ */
+bool GossipProtocol::handle(MP1Node *node, MsgView *msg) {
+	if ( msg->getType() != HEARTBEAT ) {
+		return false;
+	}
+	node->handleHeartbeat(msg);
+	return true;
+}
@@ -0,0 +1,81 @@
+/**********************************
+ * FILE NAME: Protocol.h
+ *
+ * DESCRIPTION: Failure detection strategies run by a node.
+ * 				Header file of Protocol classes.
+ **********************************/
+
+#ifndef _PROTOCOL_H_
+#define _PROTOCOL_H_
+
+#include "stdincludes.h"
+#include "Params.h"
+
+class MP1Node;
+class MsgView;
+
+/**
+ * CLASS NAME: Protocol
+ *
+ * DESCRIPTION: How a node that is in the group keeps its membership list current.  tick()
+ *              runs the periodic duties once per tick; handle() gets every received
+ *              message first and returns true if it consumed it.  Joining, leaving, the
+ *              message plumbing and the list itself stay in MP1Node, so all strategies
+ *              report the same metrics.  Create one with Protocol::create().
+ */
+class Protocol {
+public:
+	virtual ~Protocol() {}
+	virtual const char *name() = 0;
+	virtual void tick(MP1Node *node) = 0;
+	virtual bool handle(MP1Node *node, MsgView *msg) = 0;
+	static Protocol *create(Params *par);
+};
+
+/**
+ * CLASS NAME: SwimProtocol
+ *
+ * DESCRIPTION: Round-robin probing with indirect probes (or phi accrual), failures
+ *              disseminated on the probes
+ */
+class SwimProtocol: public Protocol {
+public:
+	const char *name() { return "swim"; }
+	void tick(MP1Node *node);
+	bool handle(MP1Node *node, MsgView *msg) { return false; }
+};
+
+/**
+ * CLASS NAME: AllToAllProtocol
+ *
+ * DESCRIPTION: Every tick each node sends a HEARTBEAT to every member, and removes members
+ *              whose heartbeat has not advanced for HEARTBEAT_TIMEOUT ticks
+ */
+class AllToAllProtocol: public Protocol {
+private:
+	Params *par;
+public:
+	AllToAllProtocol(Params *par): par(par) {}
+	const char *name() { return "alltoall"; }
+	void tick(MP1Node *node);
+	bool handle(MP1Node *node, MsgView *msg);
+};
+
+/**
+ * CLASS NAME: GossipProtocol
+ *
+ * DESCRIPTION: Every tick each node sends its whole list to GOSSIP_FANOUT random members,
+ *              and removes members whose heartbeat has not advanced for HEARTBEAT_TIMEOUT
+ *              ticks
+ */
+class GossipProtocol: public Protocol {
+private:
+	Params *par;
+public:
+	GossipProtocol(Params *par): par(par) {}
+	const char *name() { return "gossip"; }
+	void tick(MP1Node *node);
+	bool handle(MP1Node *node, MsgView *msg);
+};
+
+#endif /* _PROTOCOL_H_ */
@@ -0,0 +1,114 @@
+/**********************************
+ * FILE NAME: SnapshotTest.cpp
+ *
+ * DESCRIPTION: Multi-threaded test of SnapshotPublisher, meant to run under ThreadSanitizer
+ * 				(make snapshottest).  Reader threads acquire, read and release snapshots
+ * 				while the main thread publishes and reclaims them as fast as it can.  A
+ * 				snapshot freed while a reader still holds it shows up as a data race
+ * 				(or a use after free) in the TSan report, or as a torn snapshot below.
+ **********************************/
+
+#include "ViewSnapshot.h"
+#include <thread>
+
+/*
+ * Macros
+ */
+#define TEST_READERS 8
+#define TEST_VERSIONS 20000
+// Members in the snapshot of a version: 1 + version % TEST_MEMBERS
+#define TEST_MEMBERS 16
+
+static atomic<bool> done(false);
+static atomic<long> failures(0);
+static atomic<long> reads(0);
+
+/**
+ * FUNCTION NAME: makeSnapshot
+ *
+ * DESCRIPTION: Snapshot of a version whose entries all carry the version, so that a
+ *              reader can tell a whole snapshot from a freed or reused one
+ */
+static ViewSnapshot *makeSnapshot(long version) {
+	vector<MemberListEntry> members;
+
+	for ( int i = 0; i <= version % TEST_MEMBERS; i++ ) {
+		members.push_back(MemberListEntry(i + 1, 0, version, version));
+	}
+	return new ViewSnapshot(version, version, members);
+}
+
+/**
+ * FUNCTION NAME: reader
+ *
+ * DESCRIPTION: Body of a reader thread: check every snapshot it sees and that versions
+ *              never go back
+ */
+static void reader(SnapshotPublisher *pub) {
+	int slot = pub->registerReader();
+	long last = 0;
+
+	if ( slot < 0 ) {
+		failures++;
+		return;
+	}
+	while ( !done.load() ) {
+		const ViewSnapshot *snap = pub->acquire(slot);
+		if ( snap != NULL ) {
+			bool whole = snap->version >= last && (long) snap->members.size() == 1 + snap->version % TEST_MEMBERS;
+			for ( int i = 0; whole && i < (int) snap->members.size(); i++ ) {
+				MemberListEntry mle = snap->members[i];
+				whole = mle.getheartbeat() == snap->version;
+			}
+			if ( !whole ) {
+				failures++;
+			}
+			last = snap->version;
+			reads++;
+		}
+		pub->release(slot);
+	}
+	pub->unregisterReader(slot);
+}
+
+/**
+ * FUNCTION NAME: main
+ */
+int main() {
+	SnapshotPublisher *pub = new SnapshotPublisher();
+	vector<thread> threads;
+	long freed = 0;
+	long version;
+
+	if ( pub->hasReaders() ) {
+		printf("FAIL: readers before any registered\n");
+		return 1;
+	}
+	for ( int i = 0; i < TEST_READERS; i++ ) {
+		threads.push_back(thread(reader, pub));
+	}
+	while ( !pub->hasReaders() ) {
+		this_thread::yield();
+	}
+
+	for ( version = 1; version <= TEST_VERSIONS; version++ ) {
+		pub->publish(makeSnapshot(version));
+		freed += pub->reclaim();
+	}
+	done.store(true);
+	for ( int i = 0; i < (int) threads.size(); i++ ) {
+		threads[i].join();
+	}
+
+	// With every reader gone, all but the current snapshot must be reclaimable
+	freed += pub->reclaim();
+	if ( pub->hasReaders() || pub->retiredCount() != 0 || freed != TEST_VERSIONS - 1 ||
+			pub->currentVersion() != TEST_VERSIONS ) {
+		failures++;
+	}
+	delete pub;
+
+	printf("%s: %d readers, %ld reads, %d versions, %ld reclaimed, %ld failures\n",
+			failures.load() == 0 ? "PASS" : "FAIL", TEST_READERS, reads.load(), TEST_VERSIONS, freed, failures.load());
+	return failures.load() == 0 ? 0 : 1;
+}
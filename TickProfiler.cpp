@@ -0,0 +1,246 @@
+/**********************************
+ * FILE NAME: TickProfiler.cpp
+ *
+ * DESCRIPTION: Wall-clock and cycle cost of the phases of a tick, per node.
+ * 				Definition of TickProfiler class functions.
+ **********************************/
+
+#include "TickProfiler.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/**
+ * Constructor
+ */
+TickProfiler::TickProfiler(Params *par): par(par), depth(0), overflow(0), node(0), path(0),
+	phases(NUM_PROFILE_PHASES), nodes(par->EN_GPSZ + 1, vector<unsigned long>(NUM_PROFILE_PHASES, 0)),
+	nodeTotals(par->EN_GPSZ + 1, 0) {}
+
+/**
+ * Destructor
+ */
+TickProfiler::~TickProfiler() {}
+
+/**
+ * FUNCTION NAME: now
+ *
+ * DESCRIPTION: Monotonic wall clock in ns
+ */
+unsigned long TickProfiler::now() {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long) ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+
+/**
+ * FUNCTION NAME: cycles
+ *
+ * DESCRIPTION: Time-stamp counter (0 where there is none)
+ */
+unsigned long TickProfiler::cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+/**
+ * FUNCTION NAME: bucket
+ *
+ * DESCRIPTION: Histogram bucket of a duration: floor(log2(ns))
+ */
+int TickProfiler::bucket(unsigned long ns) {
+	if ( ns == 0 ) {
+		return 0;
+	}
+	return min(PROFILE_BUCKETS - 1, 63 - __builtin_clzl(ns));
+}
+
+/**
+ * FUNCTION NAME: phaseName
+ *
+ * DESCRIPTION: Name of a phase as it appears in the output
+ */
+const char *TickProfiler::phaseName(int phase) {
+	static const char *names[PROF_MSG] = { "recvLoop", "nodeLoop", "checkMessages", "nodeLoopOps", "flushMessages", "LOG" };
+
+	if ( phase < PROF_MSG ) {
+		return names[phase];
+	}
+	if ( phase - PROF_MSG < DUMMYLASTMSGTYPE ) {
+		return msgTypeName(phase - PROF_MSG);
+	}
+	return "UNKNOWN";
+}
+
+/**
+ * FUNCTION NAME: enter
+ *
+ * DESCRIPTION: Open a phase.  node is only used for an outermost phase; a negative one
+ *              means the application.
+ */
+void TickProfiler::enter(int phase, int node) {
+	if ( depth == PROFILE_DEPTH ) {
+		overflow++;
+		return;
+	}
+	if ( depth == 0 ) {
+		this->node = (node < 0 || node > par->EN_GPSZ) ? 0 : node;
+		path = 0;
+	}
+	stack[depth].phase = phase;
+	stack[depth].child = 0;
+	path |= (unsigned long) (phase + 1) << (8 * depth);
+	depth++;
+	stack[depth - 1].cycles = cycles();
+	stack[depth - 1].ns = now();
+}
+
+/**
+ * FUNCTION NAME: leave
+ *
+ * DESCRIPTION: Close the last phase opened and charge its cost
+ */
+void TickProfiler::leave() {
+	unsigned long ns = now();
+	unsigned long cyc = cycles();
+	Frame *f;
+
+	if ( overflow > 0 ) {
+		overflow--;
+		return;
+	}
+	if ( depth == 0 ) {
+		return;
+	}
+
+	f = &stack[--depth];
+	ns -= f->ns;
+	cyc -= f->cycles;
+
+	PhaseCost &cost = phases[f->phase];
+	cost.calls++;
+	cost.ns += ns;
+	cost.cycles += cyc;
+	cost.hist[bucket(ns)]++;
+
+	nodes[node][f->phase] += ns;
+	folded[(unsigned long) node << 40 | path] += ns - min(ns, f->child);
+	path &= ~(0xffUL << (8 * depth));
+	if ( depth > 0 ) {
+		stack[depth - 1].child += ns;
+	}
+	else {
+		nodeTotals[node] += ns;
+	}
+}
+
+/**
+ * FUNCTION NAME: percentile
+ *
+ * DESCRIPTION: Upper bound, in ns, of the histogram bucket holding the q-th quantile of
+ *              the durations of a phase
+ */
+unsigned long TickProfiler::percentile(int phase, double q) {
+	PhaseCost &cost = phases[phase];
+	long seen = 0;
+
+	for ( int b = 0; b < PROFILE_BUCKETS; b++ ) {
+		seen += cost.hist[b];
+		if ( seen > 0 && seen >= q * cost.calls ) {
+			return 1UL << (b + 1);
+		}
+	}
+	return 0;
+}
+
+/**
+ * FUNCTION NAME: appendStack
+ *
+ * DESCRIPTION: Folded form of a stack key: node;phase;phase...
+ */
+void TickProfiler::appendStack(string &out, unsigned long key) {
+	char buf[32];
+	int n = (int) (key >> 40);
+
+	if ( n == 0 ) {
+		out += "app";
+	}
+	else {
+		sprintf(buf, "node%d", n);
+		out += buf;
+	}
+	for ( int level = 0; level < PROFILE_DEPTH; level++ ) {
+		int phase = (int) ((key >> (8 * level)) & 0xff);
+		if ( phase == 0 ) {
+			break;
+		}
+		out += ';';
+		out += phaseName(phase - 1);
+	}
+}
+
+/**
+ * FUNCTION NAME: dump
+ *
+ * DESCRIPTION: Write the phase histograms and the per-node costs to PROFILE_LOG and the
+ *              folded stacks to PROFILE_FOLDED
+ */
+void TickProfiler::dump() {
+	map<unsigned long, unsigned long> stacks(folded.begin(), folded.end());
+	map<unsigned long, unsigned long>::iterator it;
+	vector< pair<unsigned long, int> > byCost;
+	FILE *fp;
+	int p, b, i;
+
+	fp = fopen(PROFILE_FOLDED, "w");
+	if ( fp != NULL ) {
+		for ( it = stacks.begin(); it != stacks.end(); it++ ) {
+			string line;
+			appendStack(line, it->first);
+			fprintf(fp, "%s %lu\n", line.c_str(), it->second);
+		}
+		fclose(fp);
+	}
+
+	fp = fopen(PROFILE_LOG, "w");
+	if ( fp == NULL ) {
+		return;
+	}
+
+	for ( p = 0; p < NUM_PROFILE_PHASES; p++ ) {
+		PhaseCost &cost = phases[p];
+		if ( cost.calls == 0 ) {
+			continue;
+		}
+		fprintf(fp, "%s: %ld calls, %.3f ms, %lu cycles, mean %lu ns, p50 < %lu ns, p99 < %lu ns\n", phaseName(p),
+				cost.calls, cost.ns / 1e6, cost.cycles, cost.ns / cost.calls, percentile(p, 0.5), percentile(p, 0.99));
+		for ( b = 0; b < PROFILE_BUCKETS; b++ ) {
+			if ( cost.hist[b] > 0 ) {
+				fprintf(fp, "  [%12lu, %12lu) ns %8ld\n", 1UL << b, 1UL << (b + 1), cost.hist[b]);
+			}
+		}
+	}
+
+	for ( i = 0; i <= par->EN_GPSZ; i++ ) {
+		byCost.push_back(make_pair(getNodeTotal(i), i));
+	}
+	sort(byCost.rbegin(), byCost.rend());
+	fprintf(fp, "\nnodes by cost (ms):\n");
+	for ( i = 0; i < (int) byCost.size() && byCost[i].first > 0; i++ ) {
+		int n = byCost[i].second;
+		string label;
+		appendStack(label, (unsigned long) n << 40);
+		fprintf(fp, "  %-8s %10.3f", label.c_str(), byCost[i].first / 1e6);
+		for ( p = 0; p < NUM_PROFILE_PHASES; p++ ) {
+			if ( nodes[n][p] > 0 ) {
+				fprintf(fp, "  %s %.3f", phaseName(p), nodes[n][p] / 1e6);
+			}
+		}
+		fprintf(fp, "\n");
+	}
+	fclose(fp);
+}
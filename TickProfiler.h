@@ -0,0 +1,106 @@
+/**********************************
+ * FILE NAME: TickProfiler.h
+ *
+ * DESCRIPTION: Wall-clock and cycle cost of the phases of a tick, per node.
+ * 				Header file of TickProfiler class.
+ **********************************/
+
+#ifndef _TICKPROFILER_H_
+#define _TICKPROFILER_H_
+
+#include "stdincludes.h"
+#include "Params.h"
+#include "Codec.h"
+
+/*
+ * Macros
+ */
+// Deepest nesting of phases kept apart; deeper phases are charged to their parent
+#define PROFILE_DEPTH 5
+// log2 buckets of the per-call duration histograms, in ns
+#define PROFILE_BUCKETS 40
+#define PROFILE_LOG "profile.log"
+#define PROFILE_FOLDED "profile.folded"
+
+/**
+ * Phases.  A received message is timed under PROF_MSG + its type; PROF_MSG + DUMMYLASTMSGTYPE
+ * is a message of unknown type.
+ */
+enum ProfilePhase {
+	PROF_RECV,          // recvLoop, ENrecv included
+	PROF_NODELOOP,      // nodeLoop
+	PROF_MESSAGES,      // checkMessages
+	PROF_OPS,           // nodeLoopOps, or retryJoin while out of the group
+	PROF_FLUSH,         // flushMessages and publishEvents
+	PROF_LOG,           // Log::LOG
+	PROF_MSG
+};
+#define NUM_PROFILE_PHASES (PROF_MSG + DUMMYLASTMSGTYPE + 1)
+
+/**
+ * CLASS NAME: PhaseCost
+ *
+ * DESCRIPTION: Calls of a phase, their total cost and the histogram of their durations
+ */
+class PhaseCost {
+public:
+	long calls;
+	unsigned long ns;
+	unsigned long cycles;
+	long hist[PROFILE_BUCKETS];
+	PhaseCost(): calls(0), ns(0), cycles(0) { memset(hist, 0, sizeof(hist)); }
+};
+
+/**
+ * CLASS NAME: TickProfiler
+ *
+ * DESCRIPTION: Times phases with a monotonic clock and the time-stamp counter.  enter()
+ *              opens a phase and leave() closes the last one opened; a phase opened inside
+ *              another is its child, and the node given to the outermost phase (1..EN_GPSZ,
+ *              0 for the application itself) is charged for all of them.
+ *
+ *              Each phase accumulates its inclusive cost and a histogram of call durations.
+ *              Each call stack (node, outer to inner phases) accumulates its exclusive time,
+ *              which dump() writes as folded stacks for flamegraph.pl.
+ */
+class TickProfiler {
+private:
+	struct Frame {
+		int phase;
+		unsigned long ns;
+		unsigned long cycles;
+		// ns spent in the phases opened inside this one
+		unsigned long child;
+	};
+	Params *par;
+	Frame stack[PROFILE_DEPTH];
+	int depth;
+	// Phases opened beyond PROFILE_DEPTH, still to be closed
+	int overflow;
+	int node;
+	// Stack key of the open phases
+	unsigned long path;
+	vector<PhaseCost> phases;
+	// Inclusive ns per node and phase, and per node in its outermost phases
+	vector< vector<unsigned long> > nodes;
+	vector<unsigned long> nodeTotals;
+	// Exclusive ns per stack key: node << 40 | (phase + 1) << 8 * level
+	unordered_map<unsigned long, unsigned long> folded;
+	static unsigned long now();
+	static unsigned long cycles();
+	static int bucket(unsigned long ns);
+	void appendStack(string &out, unsigned long key);
+public:
+	TickProfiler(Params *par);
+	virtual ~TickProfiler();
+	void enter(int phase, int node = -1);
+	void leave();
+	static const char *phaseName(int phase);
+	const PhaseCost &getCost(int phase) { return phases[phase]; }
+	unsigned long percentile(int phase, double q);
+	unsigned long getNodeNs(int node, int phase) { return nodes[node][phase]; }
+	unsigned long getNodeTotal(int node) { return nodeTotals[node]; }
+	void dump();
+};
+
+#endif /* _TICKPROFILER_H_ */
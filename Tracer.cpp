@@ -0,0 +1,176 @@
+/**********************************
+ * FILE NAME: Tracer.cpp
+ *
+ * DESCRIPTION: Causal traces of sampled probes, written as Chrome Trace Event JSON.
+ * 				Definition of Tracer class functions.
+ **********************************/
+
+#include "Tracer.h"
+
+/**
+ * Constructor.  Opens TRACE_JSON and names a thread after every node.
+ */
+Tracer::Tracer(Params *par): par(par), first(true), probes(par->EN_GPSZ + 1, 0), slotsTick(-1), nextFlow(1) {
+	fp = fopen(TRACE_JSON, "w");
+	if ( fp == NULL ) {
+		return;
+	}
+	fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+	event("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"membership\"}}");
+	for ( int i = 1; i <= par->EN_GPSZ; i++ ) {
+		event("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"node %d\"}}", i, i);
+	}
+}
+
+/**
+ * Destructor.  Closes the JSON.
+ */
+Tracer::~Tracer() {
+	if ( fp != NULL ) {
+		fprintf(fp, "\n]}\n");
+		fclose(fp);
+	}
+}
+
+/**
+ * FUNCTION NAME: event
+ *
+ * DESCRIPTION: Append one event object to the trace
+ */
+void Tracer::event(const char *fmt, ...) {
+	va_list args;
+
+	if ( fp == NULL ) {
+		return;
+	}
+	fprintf(fp, first ? "\n" : ",\n");
+	first = false;
+	va_start(args, fmt);
+	vfprintf(fp, fmt, args);
+	va_end(args);
+}
+
+/**
+ * FUNCTION NAME: timestamp
+ *
+ * DESCRIPTION: Time of the node's next event: the start of the tick, plus TRACE_EVENT_US
+ *              for each event it already had in this tick
+ */
+long Tracer::timestamp(int node) {
+	int tick = par->getcurrtime();
+
+	if ( tick != slotsTick ) {
+		slots.clear();
+		slotsTick = tick;
+		expire();
+	}
+	return (long) tick * TRACE_TICK_US + (long) TRACE_EVENT_US * slots[node]++;
+}
+
+/**
+ * FUNCTION NAME: expire
+ *
+ * DESCRIPTION: Forget sends that can no longer be received (delivery takes one tick; the
+ *              rest were dropped)
+ */
+void Tracer::expire() {
+	long oldest = ((long) slotsTick - 1) * TRACE_TICK_US;
+	map< pair<unsigned long, long>, long >::iterator it;
+
+	for ( it = inflight.begin(); it != inflight.end(); ) {
+		if ( it->second < oldest ) {
+			inflight.erase(it++);
+		}
+		else {
+			++it;
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: startProbe
+ *
+ * DESCRIPTION: Trace id of a probe the node starts, or 0 if it is not sampled
+ */
+unsigned long Tracer::startProbe(int node, int target) {
+	long n = probes[node]++;
+	unsigned long trace;
+
+	if ( par->TRACE_SAMPLE <= 0 || n % par->TRACE_SAMPLE != 0 ) {
+		return 0;
+	}
+	trace = (unsigned long) node << 32 | (unsigned long) n;
+	event("{\"name\":\"probe %d\",\"cat\":\"probe\",\"ph\":\"b\",\"id\":\"0x%lx\",\"pid\":1,\"tid\":%d,\"ts\":%ld,\"args\":{\"target\":%d,\"tick\":%d}}",
+			target, trace, node, timestamp(node), target, par->getcurrtime());
+	return trace;
+}
+
+/**
+ * FUNCTION NAME: endProbe
+ *
+ * DESCRIPTION: Close the span of a traced probe with its outcome
+ */
+void Tracer::endProbe(unsigned long trace, int node, const char *outcome) {
+	if ( trace == 0 ) {
+		return;
+	}
+	event("{\"name\":\"probe\",\"cat\":\"probe\",\"ph\":\"e\",\"id\":\"0x%lx\",\"pid\":1,\"tid\":%d,\"ts\":%ld,\"args\":{\"outcome\":\"%s\",\"tick\":%d}}",
+			trace, node, timestamp(node), outcome, par->getcurrtime());
+}
+
+/**
+ * FUNCTION NAME: mark
+ *
+ * DESCRIPTION: Instant event of a traced probe on a node (e.g. the target is suspected)
+ */
+void Tracer::mark(unsigned long trace, int node, const char *what) {
+	if ( trace == 0 ) {
+		return;
+	}
+	event("{\"name\":\"%s\",\"cat\":\"probe\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%d,\"ts\":%ld,\"args\":{\"trace\":\"0x%lx\",\"tick\":%d}}",
+			what, node, timestamp(node), trace, par->getcurrtime());
+}
+
+/**
+ * FUNCTION NAME: sent
+ *
+ * DESCRIPTION: Slice for a traced message the node sends
+ */
+void Tracer::sent(unsigned long trace, int node, int to, int type) {
+	long ts;
+
+	if ( trace == 0 ) {
+		return;
+	}
+	ts = timestamp(node);
+	inflight[make_pair(trace, (long) node << 32 | (unsigned int) to)] = ts;
+	event("{\"name\":\"send %s\",\"cat\":\"msg\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%ld,\"dur\":%d,\"args\":{\"trace\":\"0x%lx\",\"to\":%d,\"tick\":%d}}",
+			msgTypeName(type), node, ts, TRACE_EVENT_US / 2, trace, to, par->getcurrtime());
+}
+
+/**
+ * FUNCTION NAME: received
+ *
+ * DESCRIPTION: Slice for a traced message the node handles, with a flow arrow from the
+ *              slice of its send
+ */
+void Tracer::received(unsigned long trace, int node, int from, int type) {
+	map< pair<unsigned long, long>, long >::iterator it;
+	long ts;
+
+	if ( trace == 0 ) {
+		return;
+	}
+	ts = timestamp(node);
+	event("{\"name\":\"recv %s\",\"cat\":\"msg\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%ld,\"dur\":%d,\"args\":{\"trace\":\"0x%lx\",\"from\":%d,\"tick\":%d}}",
+			msgTypeName(type), node, ts, TRACE_EVENT_US / 2, trace, from, par->getcurrtime());
+
+	it = inflight.find(make_pair(trace, (long) from << 32 | (unsigned int) node));
+	if ( it == inflight.end() ) {
+		return;
+	}
+	event("{\"name\":\"%s\",\"cat\":\"hop\",\"ph\":\"s\",\"id\":%ld,\"pid\":1,\"tid\":%d,\"ts\":%ld}", msgTypeName(type), nextFlow, from, it->second);
+	event("{\"name\":\"%s\",\"cat\":\"hop\",\"ph\":\"f\",\"bp\":\"e\",\"id\":%ld,\"pid\":1,\"tid\":%d,\"ts\":%ld}", msgTypeName(type), nextFlow, node, ts);
+	nextFlow++;
+	inflight.erase(it);
+}
@@ -0,0 +1,64 @@
+/**********************************
+ * FILE NAME: Tracer.h
+ *
+ * DESCRIPTION: Causal traces of sampled probes, written as Chrome Trace Event JSON.
+ * 				Header file of Tracer class.
+ **********************************/
+
+#ifndef _TRACER_H_
+#define _TRACER_H_
+
+#include "stdincludes.h"
+#include "Params.h"
+#include "Codec.h"
+
+/*
+ * Macros
+ */
+#define TRACE_JSON "trace.json"
+// Trace timestamps are in us; one tick is shown as 1 ms
+#define TRACE_TICK_US 1000
+// Spacing and width of the events of one node within a tick
+#define TRACE_EVENT_US 10
+
+/**
+ * CLASS NAME: Tracer
+ *
+ * DESCRIPTION: Follows one in TRACE_SAMPLE probes from PING through INDPING forwarding and
+ *              INDPINGREP relaying to its outcome.  The trace id (origin id << 32 | probe
+ *              number) travels in the trace field of the messages; 0 means untraced.
+ *
+ *              Every node is a thread of the trace.  Each traced send and receive is a
+ *              slice on the node's thread, laid out in call order within the tick, and a
+ *              flow arrow joins a receive to its send.  The probe itself is an async span
+ *              on the origin from its start to "ack", "indirect ack", "timeout" or
+ *              "dropped".  Events are streamed to TRACE_JSON, which is closed by the
+ *              destructor.
+ */
+class Tracer {
+private:
+	Params *par;
+	FILE *fp;
+	bool first;
+	// Probes started per node, for the sampling
+	vector<long> probes;
+	// Node and tick of the last event, and the events the node had in that tick
+	map<long, int> slots;
+	int slotsTick;
+	// Sends not received yet: (trace, from, to) -> ts
+	map< pair<unsigned long, long>, long > inflight;
+	long nextFlow;
+	long timestamp(int node);
+	void event(const char *fmt, ...);
+	void expire();
+public:
+	Tracer(Params *par);
+	virtual ~Tracer();
+	unsigned long startProbe(int node, int target);
+	void endProbe(unsigned long trace, int node, const char *outcome);
+	void mark(unsigned long trace, int node, const char *what);
+	void sent(unsigned long trace, int node, int to, int type);
+	void received(unsigned long trace, int node, int from, int type);
+};
+
+#endif /* _TRACER_H_ */
@@ -0,0 +1,86 @@
+/**********************************
+ * FILE NAME: ViewDigest.cpp
+ *
+ * DESCRIPTION: Compact digest of a membership list for anti-entropy.
+ * 				Definition of ViewDigest class functions.
+ **********************************/
+
+#include "ViewDigest.h"
+
+/**
+ * Constructor
+ */
+ViewDigest::ViewDigest(int buckets, int maxId): buckets(max(1, buckets)), maxId(max(1, maxId)), hashes(max(1, buckets), 0) {}
+
+/**
+ * FUNCTION NAME: hashEntry
+ *
+ * DESCRIPTION: 32-bit mix of a member address (murmur3 finaliser)
+ */
+unsigned long ViewDigest::hashEntry(int id, short port) {
+	uint32_t h = (uint32_t) id * 0x9e3779b1u ^ (uint16_t) port;
+	h ^= h >> 16;
+	h *= 0x85ebca6bu;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35u;
+	h ^= h >> 16;
+	return h;
+}
+
+/**
+ * FUNCTION NAME: bucketOf
+ *
+ * DESCRIPTION: Bucket covering a node id; ids 1..maxId are spread over equal ranges
+ */
+int ViewDigest::bucketOf(int id) {
+	long b = (long) (id - 1) * buckets / maxId;
+	return (int) max(0L, min((long) buckets - 1, b));
+}
+
+/**
+ * FUNCTION NAME: build
+ *
+ * DESCRIPTION: Recompute the bucket hashes of a membership list
+ */
+void ViewDigest::build(vector<MemberListEntry> &ml) {
+	hashes.assign(buckets, 0);
+	for ( int i = 0; i < (int) ml.size(); i++ ) {
+		int b = bucketOf(ml[i].getid());
+		hashes[b] = (hashes[b] + hashEntry(ml[i].getid(), ml[i].getport())) & 0xffffffffUL;
+	}
+}
+
+/**
+ * FUNCTION NAME: diff
+ *
+ * DESCRIPTION: Indexes of the buckets whose hash differs from the other node's digest.
+ *              A digest of another size cannot be compared, so every bucket differs.
+ */
+void ViewDigest::diff(const vector<unsigned long> &other, vector<unsigned long> &differing) {
+	for ( int b = 0; b < buckets; b++ ) {
+		if ( other.size() != hashes.size() || other[b] != hashes[b] ) {
+			differing.push_back(b);
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: select
+ *
+ * DESCRIPTION: Entries of the membership list that fall in the wanted buckets
+ */
+void ViewDigest::select(vector<MemberListEntry> &ml, const vector<unsigned long> &wanted, vector<MemberListEntry> &out) {
+	vector<bool> want(buckets, false);
+	int i;
+
+	for ( i = 0; i < (int) wanted.size(); i++ ) {
+		if ( wanted[i] < (unsigned long) buckets ) {
+			want[wanted[i]] = true;
+		}
+	}
+	for ( i = 0; i < (int) ml.size(); i++ ) {
+		if ( want[bucketOf(ml[i].getid())] ) {
+			out.push_back(ml[i]);
+		}
+	}
+}
@@ -0,0 +1,40 @@
+/**********************************
+ * FILE NAME: ViewDigest.h
+ *
+ * DESCRIPTION: Compact digest of a membership list for anti-entropy.
+ * 				Header file of ViewDigest class.
+ **********************************/
+
+#ifndef _VIEWDIGEST_H_
+#define _VIEWDIGEST_H_
+
+#include "stdincludes.h"
+#include "Member.h"
+
+/**
+ * CLASS NAME: ViewDigest
+ *
+ * DESCRIPTION: Splits the node id space into equal ranges (buckets) and keeps, per bucket,
+ *              the sum of a 32-bit hash of every member's address.  The sum does not depend
+ *              on list order, so two nodes holding the same members in a bucket get the same
+ *              value, and only buckets whose values differ need their entries exchanged.
+ *              Heartbeats are not hashed: they change every tick and are carried by the
+ *              entries that are exchanged.
+ */
+class ViewDigest {
+private:
+	int buckets;
+	int maxId;
+	vector<unsigned long> hashes;
+	static unsigned long hashEntry(int id, short port);
+public:
+	ViewDigest(int buckets, int maxId);
+	virtual ~ViewDigest() {}
+	int bucketOf(int id);
+	void build(vector<MemberListEntry> &ml);
+	const vector<unsigned long> &getHashes() { return hashes; }
+	void diff(const vector<unsigned long> &other, vector<unsigned long> &differing);
+	void select(vector<MemberListEntry> &ml, const vector<unsigned long> &wanted, vector<MemberListEntry> &out);
+};
+
+#endif /* _VIEWDIGEST_H_ */
@@ -0,0 +1,126 @@
+/**********************************
+ * FILE NAME: ViewSnapshot.cpp
+ *
+ * DESCRIPTION: Immutable snapshots of the membership view for readers on other threads.
+ * 				Definition of SnapshotPublisher class functions.
+ **********************************/
+
+#include "ViewSnapshot.h"
+
+/**
+ * Constructor
+ */
+SnapshotPublisher::SnapshotPublisher(): current(NULL), epoch(1), registered(0) {
+	for ( int i = 0; i < SNAPSHOT_READERS; i++ ) {
+		readers[i].store(0);
+		slots[i].store(false);
+	}
+}
+
+/**
+ * Destructor.  No reader may hold a snapshot any more.
+ */
+SnapshotPublisher::~SnapshotPublisher() {
+	delete current.load();
+	for ( int i = 0; i < (int) retired.size(); i++ ) {
+		delete retired[i].second;
+	}
+}
+
+/**
+ * FUNCTION NAME: registerReader
+ *
+ * DESCRIPTION: Claim a reader slot for the calling thread.  Returns -1 if all are taken.
+ */
+int SnapshotPublisher::registerReader() {
+	for ( int i = 0; i < SNAPSHOT_READERS; i++ ) {
+		bool expected = false;
+		if ( slots[i].compare_exchange_strong(expected, true) ) {
+			registered.fetch_add(1);
+			return i;
+		}
+	}
+	return -1;
+}
+
+/**
+ * FUNCTION NAME: unregisterReader
+ *
+ * DESCRIPTION: Give a reader slot back
+ */
+void SnapshotPublisher::unregisterReader(int slot) {
+	readers[slot].store(0);
+	slots[slot].store(false);
+	registered.fetch_sub(1);
+}
+
+/**
+ * FUNCTION NAME: acquire
+ *
+ * DESCRIPTION: Current snapshot, valid until release(); NULL before the first publish.
+ *              The entry epoch is announced before the pointer is loaded, so a snapshot
+ *              replaced before that epoch cannot be the one this reader sees.
+ */
+const ViewSnapshot *SnapshotPublisher::acquire(int slot) {
+	readers[slot].store(epoch.load());
+	return current.load();
+}
+
+/**
+ * FUNCTION NAME: release
+ *
+ * DESCRIPTION: Done with the snapshot returned by acquire()
+ */
+void SnapshotPublisher::release(int slot) {
+	readers[slot].store(0);
+}
+
+/**
+ * FUNCTION NAME: currentVersion
+ *
+ * DESCRIPTION: Version of the current snapshot, -1 before the first publish
+ */
+long SnapshotPublisher::currentVersion() {
+	ViewSnapshot *snap = current.load();
+
+	return snap != NULL ? snap->version : -1;
+}
+
+/**
+ * FUNCTION NAME: publish
+ *
+ * DESCRIPTION: Make snap the current snapshot and retire the one it replaces
+ */
+void SnapshotPublisher::publish(ViewSnapshot *snap) {
+	ViewSnapshot *old = current.exchange(snap);
+
+	if ( old != NULL ) {
+		retired.push_back(make_pair(epoch.fetch_add(1), old));
+	}
+}
+
+/**
+ * FUNCTION NAME: reclaim
+ *
+ * DESCRIPTION: Free the retired snapshots no reader can still hold.  Returns the number freed.
+ */
+int SnapshotPublisher::reclaim() {
+	unsigned long oldest = epoch.load();
+	int freed = 0;
+	int i;
+
+	for ( i = 0; i < SNAPSHOT_READERS; i++ ) {
+		unsigned long e = readers[i].load();
+		if ( e != 0 && e < oldest ) {
+			oldest = e;
+		}
+	}
+
+	// Retired in increasing epoch order
+	for ( i = 0; i < (int) retired.size() && retired[i].first < oldest; i++ ) {
+		delete retired[i].second;
+		freed++;
+	}
+	retired.erase(retired.begin(), retired.begin() + i);
+	return freed;
+}
@@ -0,0 +1,72 @@
+/**********************************
+ * FILE NAME: ViewSnapshot.h
+ *
+ * DESCRIPTION: Immutable snapshots of the membership view for readers on other threads.
+ * 				Header file of ViewSnapshot and SnapshotPublisher classes.
+ **********************************/
+
+#ifndef _VIEWSNAPSHOT_H_
+#define _VIEWSNAPSHOT_H_
+
+#include "stdincludes.h"
+#include "Member.h"
+
+/*
+ * Macros
+ */
+// Reader threads that can hold a snapshot at the same time
+#define SNAPSHOT_READERS 64
+
+/**
+ * CLASS NAME: ViewSnapshot
+ *
+ * DESCRIPTION: Copy of a membership list at one view version, sorted by address.
+ *              It is never modified once published.
+ */
+class ViewSnapshot {
+public:
+	long version;
+	long time;
+	vector<MemberListEntry> members;
+	ViewSnapshot(long version, long time, const vector<MemberListEntry> &members):
+		version(version), time(time), members(members) {}
+};
+
+/**
+ * CLASS NAME: SnapshotPublisher
+ *
+ * DESCRIPTION: Epoch-based publication of view snapshots.  The protocol thread swaps in a
+ *              new snapshot with publish(); readers take the current one with acquire() and
+ *              hand it back with release(), without locks or copies.  A replaced snapshot is
+ *              retired with the epoch it was replaced in and freed by reclaim() once every
+ *              reader still holding a snapshot entered after that epoch.
+ *
+ *              Each reader thread owns a slot from registerReader(), which records the
+ *              epoch it entered in (0 when idle).  Only the protocol thread may call
+ *              publish(), reclaim() and currentVersion(); it checks hasReaders() first so
+ *              that no snapshot is copied while nobody reads them.
+ */
+class SnapshotPublisher {
+private:
+	atomic<ViewSnapshot *> current;
+	atomic<unsigned long> epoch;
+	atomic<unsigned long> readers[SNAPSHOT_READERS];
+	atomic<bool> slots[SNAPSHOT_READERS];
+	atomic<int> registered;
+	// Protocol thread only: replaced snapshots and the epoch they were replaced in
+	vector< pair<unsigned long, ViewSnapshot *> > retired;
+public:
+	SnapshotPublisher();
+	virtual ~SnapshotPublisher();
+	int registerReader();
+	void unregisterReader(int slot);
+	const ViewSnapshot *acquire(int slot);
+	void release(int slot);
+	bool hasReaders() { return registered.load() > 0; }
+	long currentVersion();
+	void publish(ViewSnapshot *snap);
+	int reclaim();
+	int retiredCount() { return (int) retired.size(); }
+};
+
+#endif /* _VIEWSNAPSHOT_H_ */
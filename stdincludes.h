@@ -18,6 +18,7 @@
  * Standard Header files
  */
 #include <stdio.h>
+#include <stdint.h>
 #include <math.h>
 #include <string.h>
 #include <stdlib.h>
@@ -31,10 +32,14 @@
 #include <iostream>
 #include <vector>
 #include <map>
+#include <unordered_map>
+#include <unordered_set>
 #include <string>
 #include <algorithm>
 #include <queue>
+#include <deque>
 #include <fstream>
+#include <atomic>
 
 using namespace std;
 